@@ -0,0 +1,124 @@
+#include "async_logger.hpp"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+static size_t next_power_of_two(size_t value){
+    size_t result = 1;
+    while(result < value) result <<= 1;
+    return result;
+}
+
+async_logger::async_logger(const char *path, VkDebugUtilsMessageSeverityFlagBitsEXT min_severity, size_t queue_capacity, unsigned int repeat_limit) :
+    min_severity(min_severity), cells(next_power_of_two(queue_capacity)), mask(cells.size()-1), repeat_limit(repeat_limit) {
+    file = fopen(path,"w");
+    if(!file) throw runtime_error(string("Error opening log file ")+path);
+    for(size_t i = 0; i < cells.size(); ++i) cells[i].sequence.store(i,memory_order_relaxed);
+    writer = thread(&async_logger::run,this);
+}
+
+async_logger::~async_logger(){
+    stop();
+}
+
+void async_logger::log(VkDebugUtilsMessageSeverityFlagBitsEXT severity, int32_t id, const char *text){
+    //severity bits are ordered verbose < info < warning < error
+    if(severity < min_severity.load(memory_order_relaxed)) return;
+
+    size_t position = enqueue_position.load(memory_order_relaxed);
+    cell *target;
+    while(1){
+        target = &cells[position&mask];
+        size_t sequence = target->sequence.load(memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence-(intptr_t)position;
+        if(difference == 0){
+            if(enqueue_position.compare_exchange_weak(position,position+1,memory_order_relaxed)) break;
+        }else if(difference < 0){
+            dropped.fetch_add(1,memory_order_relaxed);
+            return;
+        }else position = enqueue_position.load(memory_order_relaxed);
+    }
+
+    target->data.severity = severity;
+    target->data.id = id;
+    size_t length = text ? strlen(text) : 0;
+    if(length >= sizeof(target->data.text)) length = sizeof(target->data.text)-1;
+    if(length) memcpy(target->data.text,text,length);
+    target->data.text[length] = '\0';
+    target->data.length = length;
+    target->sequence.store(position+1,memory_order_release);
+}
+
+bool async_logger::try_pop(message &out){
+    cell &source = cells[dequeue_position&mask];
+    if(source.sequence.load(memory_order_acquire) != dequeue_position+1) return false;
+    out = source.data;
+    source.sequence.store(dequeue_position+mask+1,memory_order_release);
+    ++dequeue_position;
+    return true;
+}
+
+static char severity_letter(uint32_t severity){
+    if(severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) return 'E';
+    if(severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) return 'W';
+    if(severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) return 'I';
+    return 'V';
+}
+
+void async_logger::run(){
+    //only this thread touches the file and the repeat table, so neither needs locking
+    const size_t batch_size = 64*1024;
+    vector<char> batch(batch_size);
+    while(running.load(memory_order_acquire)){
+        if(!write_batch(batch.data(),batch_size)) this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    while(write_batch(batch.data(),batch_size));
+
+    for(auto &repeat : repeats){
+        if(repeat.second <= repeat_limit) continue;
+        if(repeat.first>>63) fprintf(file,"message with text hash 0x%llx repeated %llu times\n",(unsigned long long)(repeat.first&~(1ull<<63)),(unsigned long long)repeat.second);
+        else fprintf(file,"message id 0x%llx repeated %llu times\n",(unsigned long long)repeat.first,(unsigned long long)repeat.second);
+    }
+}
+
+size_t async_logger::write_batch(char *batch, size_t batch_size){
+    message entry;
+    size_t used = 0, count = 0;
+    while(used+sizeof(entry.text)+16 < batch_size && try_pop(entry)){
+        ++count;
+        //keyed by message id, loader messages all share id 0 so those key on their text instead
+        uint64_t key = entry.id ? (uint64_t)(uint32_t)entry.id : hash<string>()(string(entry.text,entry.length))|1ull<<63;
+        if(++repeats[key] > repeat_limit) continue;
+        used += snprintf(batch+used,batch_size-used,"[%c] %s\n",severity_letter(entry.severity),entry.text);
+    }
+    if(used){
+        fwrite(batch,1,used,file);
+        fflush(file);
+    }
+    return count;
+}
+
+void async_logger::stop(){
+    if(!file) return;
+    running.store(false,memory_order_release);
+    if(writer.joinable()) writer.join();
+    uint64_t lost = dropped.load(memory_order_relaxed);
+    if(lost) fprintf(file,"%llu messages dropped, log queue was full\n",(unsigned long long)lost);
+    fclose(file);
+    file = nullptr;
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL async_logger::debug_messenger_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT /*message_flags*/, const VkDebugUtilsMessengerCallbackDataEXT *callback_data, void *user_data){
+    static_cast<async_logger*>(user_data)->log(message_severity,callback_data->messageIdNumber,callback_data->pMessage);
+    return VK_FALSE;
+}
+
+VkDebugUtilsMessageSeverityFlagBitsEXT parse_log_severity(const char *name){
+    if(!strcmp(name,"verbose")) return VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+    if(!strcmp(name,"info")) return VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+    if(!strcmp(name,"warning")) return VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+    if(!strcmp(name,"error")) return VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    throw runtime_error(string("Unknown log level: ")+name);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+//debug messenger sink: the callback only copies into a preallocated queue, a background thread formats, dedupes and writes in batches
+class async_logger{
+public:
+    //queue_capacity is rounded up to a power of two, repeat_limit is how many times one message id is written before being counted instead
+    async_logger(const char *path, VkDebugUtilsMessageSeverityFlagBitsEXT min_severity, size_t queue_capacity = 1024, unsigned int repeat_limit = 3);
+    ~async_logger();
+
+    //every severity, for VkDebugUtilsMessengerCreateInfoEXT::messageSeverity, log() filters against min_severity instead so
+    //set_min_severity can loosen the level after the messenger exists as well as tighten it
+    static constexpr VkDebugUtilsMessageSeverityFlagsEXT all_severities = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT|VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT|
+        VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT|VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+    void set_min_severity(VkDebugUtilsMessageSeverityFlagBitsEXT severity){ min_severity.store(severity,std::memory_order_relaxed); }
+
+    //safe to call from any thread, never blocks or allocates, drops the message if the queue is full
+    void log(VkDebugUtilsMessageSeverityFlagBitsEXT severity, int32_t id, const char *text);
+
+    //drains the queue, writes the repeat summary and closes the file
+    void stop();
+
+    static VKAPI_ATTR VkBool32 VKAPI_CALL debug_messenger_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_flags, const VkDebugUtilsMessengerCallbackDataEXT *callback_data, void *user_data);
+
+private:
+    struct message{
+        uint32_t severity;
+        int32_t id;
+        uint32_t length;
+        char text[1012];
+    };
+    struct cell{
+        std::atomic<size_t> sequence;
+        message data;
+    };
+
+    bool try_pop(message &out);
+    void run();
+    size_t write_batch(char *batch, size_t batch_size);
+
+    FILE *file;
+    std::atomic<uint32_t> min_severity;
+    std::vector<cell> cells;
+    size_t mask;
+    std::atomic<size_t> enqueue_position {0};
+    size_t dequeue_position = 0;
+    std::atomic<uint64_t> dropped {0};
+    unsigned int repeat_limit;
+    //occurrences per message key, only touched by the writer thread
+    std::unordered_map<uint64_t,uint64_t> repeats;
+    std::atomic<bool> running {true};
+    std::thread writer;
+};
+
+//parses verbose/info/warning/error, throws runtime_error otherwise
+VkDebugUtilsMessageSeverityFlagBitsEXT parse_log_severity(const char *name);
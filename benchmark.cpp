@@ -0,0 +1,82 @@
+#include "benchmark.hpp"
+#include "parallel_recorder.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <numeric>
+#include <thread>
+using namespace std;
+
+void frame_stats::add_cpu_frame(double ms){
+    if(skipped_cpu_frames < warmup_frames) ++skipped_cpu_frames;
+    else cpu_ms.push_back(ms);
+}
+
+void frame_stats::add_gpu_frame(double ms){
+    if(skipped_gpu_frames < warmup_frames) ++skipped_gpu_frames;
+    else gpu_ms.push_back(ms);
+}
+
+void frame_stats::add_latency(double ms){
+    if(skipped_latency_frames < warmup_frames) ++skipped_latency_frames;
+    else latency_ms.push_back(ms);
+}
+
+static double percentile(const vector<double> &sorted, double p){
+    return sorted[min(sorted.size()-1,(size_t)(p*(sorted.size()-1)+0.5))];
+}
+
+static void report_series(FILE *out, const char *name, vector<double> samples){
+    if(samples.empty()){
+        fprintf(out,"%-4s n/a\n",name);
+        return;
+    }
+    sort(samples.begin(),samples.end());
+    double mean = accumulate(samples.begin(),samples.end(),0.0)/samples.size();
+    fprintf(out,"%-4s min %8.3f ms  mean %8.3f ms  p50 %8.3f ms  p99 %8.3f ms\n",name,samples.front(),mean,percentile(samples,0.5),percentile(samples,0.99));
+}
+
+void frame_stats::report(FILE *out, const char *device_name, const char *build_variant) const{
+    double total = accumulate(cpu_ms.begin(),cpu_ms.end(),0.0);
+    fprintf(out,"device: %s\n",device_name);
+    fprintf(out,"variant: %s\n",build_variant);
+    if(pipeline_ms >= 0) fprintf(out,"pipeline creation: %.3f ms (%s cache)\n",pipeline_ms,pipeline_warm ? "warm" : "cold");
+    fprintf(out,"frames: %zu (+%u warmup)\n",cpu_ms.size(),skipped_cpu_frames);
+    report_series(out,"cpu",cpu_ms);
+    report_series(out,"gpu",gpu_ms);
+    report_series(out,"lat",latency_ms);
+    fprintf(out,"fps: %.1f\n",total > 0 ? cpu_ms.size()*1000.0/total : 0.0);
+}
+
+void record_scaling_benchmark(FILE *out, VkDevice logical_device, unsigned int queue_family_index, VkRenderPass renderpass, VkFramebuffer framebuffer, const function<void(VkCommandBuffer)> &bind_state){
+    const unsigned int iterations = 10, warmup = 2;
+    unsigned int max_threads = max(1u,thread::hardware_concurrency());
+    vector<unsigned int> thread_counts;
+    for(unsigned int threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    VkCommandBufferInheritanceInfo inheritance_info {};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.pNext = nullptr;
+    inheritance_info.renderPass = renderpass;
+    inheritance_info.subpass = 0;
+    inheritance_info.framebuffer = framebuffer;
+    inheritance_info.occlusionQueryEnable = VK_FALSE;
+
+    fprintf(out,"%10s %8s %12s %14s\n","draws","threads","record ms","Mdraws/s");
+    for(unsigned int draw_count : {1000u,10000u,100000u}){
+        vector<draw_item> draws(draw_count,draw_item{3,1,0,0,0});
+        for(unsigned int threads : thread_counts){
+            worker_pool workers(threads);
+            parallel_recorder recorder(logical_device,queue_family_index,workers,1);
+            uint64_t total_ns = 0;
+            for(unsigned int i = 0; i < warmup+iterations; ++i){
+                uint64_t begin_ns = frame_profiler::now_ns();
+                recorder.record(0,inheritance_info,bind_state,draws);
+                if(i >= warmup) total_ns += frame_profiler::now_ns()-begin_ns;
+            }
+            recorder.destroy();
+            double ms = total_ns/1e6/iterations;
+            fprintf(out,"%10u %8u %12.3f %14.2f\n",draw_count,threads,ms,draw_count/ms/1e3);
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+//collects per-frame CPU and GPU times and input-to-render latency (in milliseconds) and prints min/mean/p50/p99 and frames per second
+class frame_stats{
+public:
+    explicit frame_stats(unsigned int warmup_frames) : warmup_frames(warmup_frames) {}
+
+    void add_cpu_frame(double ms);
+    void add_gpu_frame(double ms);
+    //from sampling input to the GPU finishing the frame, scanout and compositor latency are not included
+    void add_latency(double ms);
+    //startup cost of vkCreateGraphicsPipelines, warm_cache says whether a persisted pipeline cache was loaded
+    void set_pipeline_creation(double ms, bool warm_cache){ pipeline_ms = ms; pipeline_warm = warm_cache; }
+    void report(FILE *out, const char *device_name, const char *build_variant) const;
+
+private:
+    unsigned int warmup_frames, skipped_cpu_frames = 0, skipped_gpu_frames = 0, skipped_latency_frames = 0;
+    std::vector<double> cpu_ms, gpu_ms, latency_ms;
+    double pipeline_ms = -1;
+    bool pipeline_warm = false;
+};
+
+//records 1k-100k draws into secondary command buffers with 1 to hardware_concurrency threads and prints the mean recording time of each pair
+void record_scaling_benchmark(FILE *out, VkDevice logical_device, unsigned int queue_family_index, VkRenderPass renderpass, VkFramebuffer framebuffer, const std::function<void(VkCommandBuffer)> &bind_state);
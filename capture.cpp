@@ -0,0 +1,224 @@
+#include "capture.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+using namespace std;
+
+//the last byte is the format version
+static const unsigned char capture_magic[8] = {'T','R','I','C','A','P','\0',1};
+
+bool capture_settings::operator==(const capture_settings &other) const{
+    return width == other.width && height == other.height && draws == other.draws && materials == other.materials
+        && frames_in_flight == other.frames_in_flight && indirect_draws == other.indirect_draws && bindless == other.bindless
+        && color_mode == other.color_mode && async_compute == other.async_compute && low_latency == other.low_latency
+        && presentation_policy == other.presentation_policy;
+}
+
+//LEB128, counts and extents mostly fit one or two bytes
+static void put_varint(vector<unsigned char> &data, uint64_t value){
+    while(value >= 0x80){
+        data.push_back((value & 0x7f)|0x80);
+        value >>= 7;
+    }
+    data.push_back(value);
+}
+
+//fixed size fields are stored in host byte order, captures are compared on the machine class that wrote them
+static void put_bytes(vector<unsigned char> &data, const void *value, size_t size){
+    const unsigned char *bytes = static_cast<const unsigned char*>(value);
+    data.insert(data.end(),bytes,bytes+size);
+}
+
+struct capture_reader{
+    const vector<unsigned char> &data;
+    const char *path;
+    size_t offset = 0;
+
+    void bytes(void *value, size_t size){
+        if(data.size()-offset < size) throw runtime_error(string("Capture ")+path+" is truncated");
+        memcpy(value,data.data()+offset,size);
+        offset += size;
+    }
+    uint64_t varint(){
+        uint64_t value = 0;
+        for(unsigned int shift = 0; shift < 64; shift += 7){
+            unsigned char byte;
+            bytes(&byte,1);
+            value |= (uint64_t)(byte & 0x7f)<<shift;
+            if(!(byte & 0x80)) return value;
+        }
+        throw runtime_error(string("Capture ")+path+" is corrupt");
+    }
+};
+
+capture_stream capture_stream::load(const char *path){
+    vector<unsigned char> data;
+    FILE *file = fopen(path,"rb");
+    if(!file) throw runtime_error(string("Error opening capture ")+path);
+    fseek(file,0,SEEK_END);
+    long size = ftell(file);
+    fseek(file,0,SEEK_SET);
+    if(size > 0){
+        data.resize(size);
+        if(fread(data.data(),1,size,file) != (size_t)size) data.clear();
+    }
+    fclose(file);
+    if(data.size() < sizeof(capture_magic) || memcmp(data.data(),capture_magic,sizeof(capture_magic))) throw runtime_error(string(path)+" is not a capture of this version");
+
+    capture_reader reader{data,path,sizeof(capture_magic)};
+    capture_stream stream;
+    capture_settings &settings = stream.settings;
+    settings.width = reader.varint();
+    settings.height = reader.varint();
+    settings.draws = reader.varint();
+    settings.materials = reader.varint();
+    settings.frames_in_flight = reader.varint();
+    reader.bytes(&settings.indirect_draws,1);
+    reader.bytes(&settings.bindless,1);
+    reader.bytes(&settings.color_mode,1);
+    reader.bytes(&settings.async_compute,1);
+    reader.bytes(&settings.low_latency,1);
+    reader.bytes(&settings.presentation_policy,1);
+
+    uint64_t frame_count = reader.varint();
+    //every frame takes at least 20 bytes, so a corrupt count can not make the resize below huge
+    if(frame_count > data.size()/20) throw runtime_error(string("Capture ")+path+" is corrupt");
+    stream.frames.resize(frame_count);
+    for(captured_frame &frame : stream.frames){
+        reader.bytes(&frame.events,1);
+        if(frame.events & capture_resize){
+            frame.width = reader.varint();
+            frame.height = reader.varint();
+            //a minimized window never gets recorded as a resize, so an empty extent means the file is damaged
+            if(!frame.width || !frame.height) throw runtime_error(string("Capture ")+path+" resizes to an empty extent");
+        }
+        if(frame.events & capture_present_policy){
+            reader.bytes(&frame.presentation_policy,1);
+            frame.present_mode = reader.varint();
+        }
+        reader.bytes(frame.camera,sizeof(frame.camera));
+        frame.draw_count = reader.varint();
+        reader.bytes(&frame.draw_hash,sizeof(frame.draw_hash));
+        frame.upload_bytes = reader.varint();
+        reader.bytes(&frame.cpu_ms,sizeof(frame.cpu_ms));
+        reader.bytes(&frame.gpu_ms,sizeof(frame.gpu_ms));
+    }
+    return stream;
+}
+
+void capture_stream::save(const char *path) const{
+    vector<unsigned char> data(capture_magic,capture_magic+sizeof(capture_magic));
+    put_varint(data,settings.width);
+    put_varint(data,settings.height);
+    put_varint(data,settings.draws);
+    put_varint(data,settings.materials);
+    put_varint(data,settings.frames_in_flight);
+    put_bytes(data,&settings.indirect_draws,1);
+    put_bytes(data,&settings.bindless,1);
+    put_bytes(data,&settings.color_mode,1);
+    put_bytes(data,&settings.async_compute,1);
+    put_bytes(data,&settings.low_latency,1);
+    put_bytes(data,&settings.presentation_policy,1);
+
+    put_varint(data,frames.size());
+    for(const captured_frame &frame : frames){
+        put_bytes(data,&frame.events,1);
+        if(frame.events & capture_resize){
+            put_varint(data,frame.width);
+            put_varint(data,frame.height);
+        }
+        if(frame.events & capture_present_policy){
+            put_bytes(data,&frame.presentation_policy,1);
+            put_varint(data,frame.present_mode);
+        }
+        put_bytes(data,frame.camera,sizeof(frame.camera));
+        put_varint(data,frame.draw_count);
+        put_bytes(data,&frame.draw_hash,sizeof(frame.draw_hash));
+        put_varint(data,frame.upload_bytes);
+        put_bytes(data,&frame.cpu_ms,sizeof(frame.cpu_ms));
+        put_bytes(data,&frame.gpu_ms,sizeof(frame.gpu_ms));
+    }
+
+    string temporary_path = string(path)+".tmp";
+    FILE *file = fopen(temporary_path.c_str(),"wb");
+    if(!file) throw runtime_error("Error writing capture "+temporary_path);
+    bool written = fwrite(data.data(),1,data.size(),file) == data.size() && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    fclose(file);
+    if(!written || rename(temporary_path.c_str(),path)){
+        remove(temporary_path.c_str());
+        throw runtime_error(string("Error writing capture ")+path);
+    }
+}
+
+uint64_t hash_draws(const void *data, size_t size, uint64_t hash){
+    //a word at a time, like the descriptor layout keys, so hashing 100k draws stays well under a millisecond
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    size_t i = 0;
+    for(; i+8 <= size; i += 8){
+        uint64_t word;
+        memcpy(&word,bytes+i,8);
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    for(; i < size; ++i){
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static double median(vector<double> samples){
+    if(samples.empty()) return 0;
+    nth_element(samples.begin(),samples.begin()+samples.size()/2,samples.end());
+    return samples[samples.size()/2];
+}
+
+bool compare_to_baseline(FILE *out, const capture_stream &run, const capture_stream &baseline, unsigned int warmup_frames, double threshold_percent){
+    if(!(run.settings == baseline.settings)) throw runtime_error("Baseline was captured with different settings");
+
+    //frame by frame, only frames both runs have a time for
+    const double limit = 1+threshold_percent/100;
+    vector<double> run_cpu, baseline_cpu, run_gpu, baseline_gpu;
+    unsigned int compared = 0, slower = 0;
+    size_t frame_count = min(run.frames.size(),baseline.frames.size());
+    for(size_t i = warmup_frames; i < frame_count; ++i){
+        const captured_frame &current = run.frames[i], &reference = baseline.frames[i];
+        bool regressed = false;
+        if(current.cpu_ms >= 0 && reference.cpu_ms >= 0){
+            run_cpu.push_back(current.cpu_ms);
+            baseline_cpu.push_back(reference.cpu_ms);
+            regressed = current.cpu_ms > reference.cpu_ms*limit;
+        }
+        if(current.gpu_ms >= 0 && reference.gpu_ms >= 0){
+            run_gpu.push_back(current.gpu_ms);
+            baseline_gpu.push_back(reference.gpu_ms);
+            regressed = regressed || current.gpu_ms > reference.gpu_ms*limit;
+        }
+        ++compared;
+        if(regressed) ++slower;
+    }
+    if(run_cpu.empty()){
+        fprintf(out,"baseline: no frames to compare after %u warmup frames\n",warmup_frames);
+        return false;
+    }
+
+    //single frames are noisy, only the medians decide
+    bool passed = true;
+    auto compare = [&](const char *name, const vector<double> &current, const vector<double> &reference){
+        if(current.empty()){
+            fprintf(out,"baseline: %s n/a\n",name);
+            return;
+        }
+        double now = median(current), before = median(reference);
+        double change = before > 0 ? (now/before-1)*100 : 0;
+        fprintf(out,"baseline: %s p50 %8.3f ms -> %8.3f ms (%+.1f%%)\n",name,before,now,change);
+        if(change > threshold_percent) passed = false;
+    };
+    compare("cpu",run_cpu,baseline_cpu);
+    compare("gpu",run_gpu,baseline_gpu);
+    fprintf(out,"baseline: %u frames compared, %.1f%% over +%.0f%%, %s\n",compared,compared ? slower*100.0/compared : 0.0,threshold_percent,
+        passed ? "within threshold" : "regression");
+    return passed;
+}
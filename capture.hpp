@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+//the workload a capture was recorded with, a replay runs with these instead of its own command line
+struct capture_settings{
+    uint32_t width = 0, height = 0, draws = 0, materials = 0, frames_in_flight = 0;
+    uint8_t indirect_draws = 0, bindless = 0, color_mode = 0, async_compute = 0, low_latency = 0, presentation_policy = 0;
+
+    bool operator==(const capture_settings &other) const;
+};
+
+//events applied ahead of a frame
+enum capture_event : uint8_t{
+    capture_resize = 1,
+    capture_present_policy = 2
+};
+
+//one frame's inputs and timings
+struct captured_frame{
+    uint8_t events = 0;
+    //the extent after capture_resize, the policy and the present mode it picked after capture_present_policy
+    uint32_t width = 0, height = 0;
+    uint8_t presentation_policy = 0;
+    uint32_t present_mode = 0;
+    float camera[2] = {0,0};
+    //draws left after culling (indirect commands or direct draws) and a hash of them, a replay culls again and checks both
+    uint32_t draw_count = 0;
+    uint64_t draw_hash = 0;
+    //bytes staged through the upload queue ahead of the frame
+    uint64_t upload_bytes = 0;
+    //negative while unknown, the GPU time arrives frames in flight later and never for the last few frames
+    float cpu_ms = -1, gpu_ms = -1;
+};
+
+//a run's per-frame inputs and timings as a compact binary stream: a header with the settings, then per frame an event byte,
+//the fields those events carry, the camera, varint coded counts and the two timings, kept in memory and written on exit
+class capture_stream{
+public:
+    capture_settings settings;
+    std::vector<captured_frame> frames;
+
+    //throws runtime_error on a missing, truncated or foreign file
+    static capture_stream load(const char *path);
+    //writes a temporary file and renames it over path, like the pipeline cache
+    void save(const char *path) const;
+};
+
+//FNV-1a over the 64-bit words of a culled draw list, chained through hash
+uint64_t hash_draws(const void *data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+//compares the p50 CPU and GPU frame times after warmup_frames with baseline's and prints both along with the share of frames
+//slower by more than threshold_percent, returns false when either p50 is, throws if baseline was captured with other settings
+bool compare_to_baseline(FILE *out, const capture_stream &run, const capture_stream &baseline, unsigned int warmup_frames, double threshold_percent);
@@ -1,2 +1,11 @@
 glslc -fshader-stage=vert shader-src/vs.glsl -o shader-bin/vs.spv
-glslc -fshader-stage=frag shader-src/fs.glsl -o shader-bin/fs.spv
\ No newline at end of file
+glslc -fshader-stage=frag shader-src/fs.glsl -o shader-bin/fs.spv
+glslc -fshader-stage=comp shader-src/particles.comp -o shader-bin/particles.spv
+# variants are specialization constants inside these modules rather than extra .spv files, reflect each module's constant ids,
+# types and defaults (and its descriptor and push constant layout) next to it so they can be checked against shader_variant::set calls
+if command -v spirv-cross >/dev/null; then
+    for module in shader-bin/*.spv; do
+        spirv-cross "$module" --reflect --output "${module%.spv}.json"
+        echo "$module: $(grep -c '"variable_id"' "${module%.spv}.json") specialization constants"
+    done
+fi
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "descriptors.hpp"
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+//FNV-1a over the key words, like the shader cache
+static uint64_t hash_key(const vector<uint64_t> &key){
+    uint64_t hash = 14695981039346656037ull;
+    for(uint64_t word : key){
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+VkDescriptorSetLayout descriptor_layout_cache::get(const vector<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSetLayoutCreateFlags flags, const vector<VkDescriptorBindingFlags> &binding_flags){
+    if(!binding_flags.empty() && binding_flags.size() != bindings.size()) throw runtime_error("Descriptor binding flags must match the bindings");
+
+    //binding order does not change the layout, so the key is built from the bindings sorted by number
+    vector<unsigned int> order(bindings.size());
+    for(unsigned int i = 0; i < order.size(); ++i) order[i] = i;
+    sort(order.begin(),order.end(),[&](unsigned int a, unsigned int b){ return bindings[a].binding < bindings[b].binding; });
+    vector<uint64_t> key = {flags,bindings.size()};
+    for(unsigned int i : order){
+        const VkDescriptorSetLayoutBinding &binding = bindings[i];
+        key.push_back((uint64_t)binding.binding<<32|binding.descriptorType);
+        key.push_back((uint64_t)binding.descriptorCount<<32|binding.stageFlags);
+        key.push_back((uint64_t)(uintptr_t)binding.pImmutableSamplers);
+        key.push_back(binding_flags.empty() ? 0 : binding_flags[i]);
+    }
+
+    vector<cached_layout> &bucket = layouts[hash_key(key)];
+    for(const cached_layout &cached : bucket){
+        if(cached.key == key){
+            ++hits;
+            return cached.layout;
+        }
+    }
+    ++misses;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info {};
+    flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flags_info.pNext = nullptr;
+    flags_info.bindingCount = binding_flags.size();
+    flags_info.pBindingFlags = binding_flags.data();
+
+    VkDescriptorSetLayoutCreateInfo set_layout_info {};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.pNext = binding_flags.empty() ? nullptr : &flags_info;
+    set_layout_info.flags = flags;
+    set_layout_info.bindingCount = bindings.size();
+    set_layout_info.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if(vkCreateDescriptorSetLayout(logical_device,&set_layout_info,nullptr,&layout)!=VK_SUCCESS) throw runtime_error("Error creating descriptor set layout");
+    bucket.push_back({move(key),layout});
+    return layout;
+}
+
+void descriptor_layout_cache::destroy(){
+    for(auto &bucket : layouts) for(cached_layout &cached : bucket.second) vkDestroyDescriptorSetLayout(logical_device,cached.layout,nullptr);
+    layouts.clear();
+}
+
+descriptor_allocator::descriptor_allocator(VkDevice logical_device, const vector<VkDescriptorPoolSize> &per_set, unsigned int sets_per_pool, VkDescriptorPoolCreateFlags flags)
+    : logical_device(logical_device), per_set(per_set), flags(flags), next_pool_sets(max(sets_per_pool,1u)) {}
+
+void descriptor_allocator::next_pool(){
+    if(!free_pools.empty()){
+        used_pools.push_back(free_pools.back());
+        free_pools.pop_back();
+        return;
+    }
+
+    vector<VkDescriptorPoolSize> sizes = per_set;
+    for(VkDescriptorPoolSize &size : sizes) size.descriptorCount *= next_pool_sets;
+
+    VkDescriptorPoolCreateInfo pool_info {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.pNext = nullptr;
+    pool_info.flags = flags;
+    pool_info.maxSets = next_pool_sets;
+    pool_info.poolSizeCount = sizes.size();
+    pool_info.pPoolSizes = sizes.data();
+
+    VkDescriptorPool pool;
+    if(vkCreateDescriptorPool(logical_device,&pool_info,nullptr,&pool)!=VK_SUCCESS) throw runtime_error("Error creating descriptor pool");
+    used_pools.push_back(pool);
+    next_pool_sets = min(next_pool_sets*2,4096u);
+}
+
+VkDescriptorSet descriptor_allocator::allocate(VkDescriptorSetLayout layout){
+    if(used_pools.empty()) next_pool();
+
+    VkDescriptorSetAllocateInfo set_info {};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.pNext = nullptr;
+    set_info.descriptorPool = used_pools.back();
+    set_info.descriptorSetCount = 1;
+    set_info.pSetLayouts = &layout;
+
+    VkDescriptorSet descriptor_set;
+    VkResult result = vkAllocateDescriptorSets(logical_device,&set_info,&descriptor_set);
+    //an exhausted pool stays in used_pools until reset, the retry comes from a fresh one
+    if(result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL){
+        next_pool();
+        set_info.descriptorPool = used_pools.back();
+        result = vkAllocateDescriptorSets(logical_device,&set_info,&descriptor_set);
+    }
+    if(result != VK_SUCCESS) throw runtime_error("Error allocating descriptor set");
+    ++allocated_sets;
+    return descriptor_set;
+}
+
+void descriptor_allocator::reset(){
+    for(VkDescriptorPool pool : used_pools){
+        if(vkResetDescriptorPool(logical_device,pool,0)!=VK_SUCCESS) throw runtime_error("Error resetting descriptor pool");
+        free_pools.push_back(pool);
+    }
+    used_pools.clear();
+    allocated_sets = 0;
+}
+
+void descriptor_allocator::destroy(){
+    for(VkDescriptorPool pool : used_pools) vkDestroyDescriptorPool(logical_device,pool,nullptr);
+    for(VkDescriptorPool pool : free_pools) vkDestroyDescriptorPool(logical_device,pool,nullptr);
+    used_pools.clear();
+    free_pools.clear();
+}
+
+bindless_table::bindless_table(VkDevice logical_device, descriptor_layout_cache &layouts, unsigned int capacity, VkShaderStageFlags stages)
+    : logical_device(logical_device), capacity(max(capacity,1u)), sets(logical_device,{{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,max(capacity,1u)}},1,VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT) {
+    VkDescriptorSetLayoutBinding binding {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = this->capacity;
+    binding.stageFlags = stages;
+    binding.pImmutableSamplers = nullptr;
+    //entries past size() are never written, partially bound makes that valid as long as no draw indexes them
+    set_layout = layouts.get({binding},VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,{VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT|VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT});
+    descriptor_set = sets.allocate(set_layout);
+}
+
+uint32_t bindless_table::add(VkImageView view, VkSampler sampler){
+    if(count == capacity) throw runtime_error("Bindless table is full");
+
+    VkDescriptorImageInfo image_info {};
+    image_info.sampler = sampler;
+    image_info.imageView = view;
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = nullptr;
+    write.dstSet = descriptor_set;
+    write.dstBinding = 0;
+    write.dstArrayElement = count;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &image_info;
+    write.pBufferInfo = nullptr;
+    write.pTexelBufferView = nullptr;
+    vkUpdateDescriptorSets(logical_device,1,&write,0,nullptr);
+    return count++;
+}
+
+void bindless_table::destroy(){
+    sets.destroy();
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+//VkDescriptorSetLayouts keyed by a hash of their bindings, create flags and binding flags, so every pass asking for the
+//same layout gets the same handle, and pipelines built from it stay layout compatible
+class descriptor_layout_cache{
+public:
+    explicit descriptor_layout_cache(VkDevice logical_device) : logical_device(logical_device) {}
+
+    //binding_flags is empty or holds one entry per binding, the layout stays owned by the cache
+    VkDescriptorSetLayout get(const std::vector<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSetLayoutCreateFlags flags = 0,
+        const std::vector<VkDescriptorBindingFlags> &binding_flags = {});
+    void destroy();
+
+    unsigned int hits = 0, misses = 0;
+
+private:
+    struct cached_layout{
+        std::vector<uint64_t> key;
+        VkDescriptorSetLayout layout;
+    };
+
+    VkDevice logical_device;
+    std::unordered_map<uint64_t,std::vector<cached_layout>> layouts;
+};
+
+//hands out descriptor sets from a growing list of pools, a pool that runs out is retired and the next one is twice as big
+//(up to 4096 sets), reset() recycles every pool with one vkResetDescriptorPool each, so sets allocated every frame from a
+//per-slot allocator are never freed one by one
+class descriptor_allocator{
+public:
+    //per_set is the expected descriptor count of each type in one set, pools hold sets_per_pool sets' worth to begin with
+    descriptor_allocator(VkDevice logical_device, const std::vector<VkDescriptorPoolSize> &per_set, unsigned int sets_per_pool = 64, VkDescriptorPoolCreateFlags flags = 0);
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    void reset();
+
+    unsigned int pool_count() const { return used_pools.size()+free_pools.size(); }
+    unsigned int allocated() const { return allocated_sets; }
+
+    void destroy();
+
+private:
+    void next_pool();
+
+    VkDevice logical_device;
+    std::vector<VkDescriptorPoolSize> per_set;
+    VkDescriptorPoolCreateFlags flags;
+    unsigned int next_pool_sets, allocated_sets = 0;
+    //used_pools.back() is the one being allocated from
+    std::vector<VkDescriptorPool> used_pools, free_pools;
+};
+
+//bindless mode: one descriptor set holding an array of capacity combined image samplers at binding 0, partially bound and
+//update-after-bind, so it is bound once per command buffer and every draw picks its image with an index (a push constant),
+//entries may be added between frames without rebinding
+class bindless_table{
+public:
+    bindless_table(VkDevice logical_device, descriptor_layout_cache &layouts, unsigned int capacity, VkShaderStageFlags stages);
+
+    VkDescriptorSetLayout layout() const { return set_layout; }
+    VkDescriptorSet set() const { return descriptor_set; }
+    unsigned int size() const { return count; }
+
+    //writes the next free entry and returns its index, throws when the table is full
+    uint32_t add(VkImageView view, VkSampler sampler);
+
+    void destroy();
+
+private:
+    VkDevice logical_device;
+    unsigned int capacity, count = 0;
+    VkDescriptorSetLayout set_layout;
+    descriptor_allocator sets;
+    VkDescriptorSet descriptor_set;
+};
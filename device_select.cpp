@@ -0,0 +1,169 @@
+#include "device_select.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+static const char *device_type_name(VkPhysicalDeviceType type){
+    switch(type){
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete GPU";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated GPU";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual GPU";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: return "CPU";
+        default: return "other device";
+    }
+}
+
+static int device_type_score(VkPhysicalDeviceType type){
+    switch(type){
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 1000;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 500;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 300;
+        //lavapipe and SwiftShader still win on machines without a GPU, they are simply never preferred over one
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: return 100;
+        default: return 0;
+    }
+}
+
+static string uuid_string(const uint8_t *uuid){
+    string result;
+    char digits[3];
+    for(unsigned int i = 0; i < VK_UUID_SIZE; ++i){
+        if(i == 4 || i == 6 || i == 8 || i == 10) result += '-';
+        snprintf(digits,sizeof(digits),"%02x",uuid[i]);
+        result += digits;
+    }
+    return result;
+}
+
+static string lowercase(const char *text, bool strip_dashes){
+    string result;
+    for(; *text; ++text) if(!strip_dashes || *text != '-') result += tolower((unsigned char)*text);
+    return result;
+}
+
+static bool matches_override(const char *device_override, const char *device_name, const string &uuid){
+    if(lowercase(device_name,false).find(lowercase(device_override,false)) != string::npos) return true;
+    return lowercase(uuid.c_str(),true) == lowercase(device_override,true);
+}
+
+//fills in choice and returns true if the device is usable, otherwise sets rejection
+static bool evaluate_device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, const vector<const char*> &required_extensions, device_choice &choice, string &rejection){
+    choice.physical_device = physical_device;
+    vkGetPhysicalDeviceProperties(physical_device,&choice.properties);
+    const VkPhysicalDeviceProperties &properties = choice.properties;
+
+    //timeline semaphores are core in 1.2
+    if(properties.apiVersion < VK_API_VERSION_1_2){
+        rejection = "Vulkan "+to_string(VK_VERSION_MAJOR(properties.apiVersion))+"."+to_string(VK_VERSION_MINOR(properties.apiVersion))+" is below 1.2";
+        return false;
+    }
+
+    unsigned int extension_count;
+    vkEnumerateDeviceExtensionProperties(physical_device,nullptr,&extension_count,nullptr);
+    vector<VkExtensionProperties> extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device,nullptr,&extension_count,extensions.data());
+    for(const char *required : required_extensions){
+        bool found = false;
+        for(const VkExtensionProperties &extension : extensions) found |= !strcmp(extension.extensionName,required);
+        if(!found){
+            rejection = string("missing ")+required;
+            return false;
+        }
+    }
+
+    unsigned int queue_family_count;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device,&queue_family_count,nullptr);
+    vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device,&queue_family_count,queue_families.data());
+
+    choice.graphics_family = -1u;
+    for(unsigned int i = 0; i < queue_family_count && choice.graphics_family == -1u; ++i){
+        if(queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT){
+            VkBool32 surface_support = VK_TRUE;
+            if(surface != VK_NULL_HANDLE) vkGetPhysicalDeviceSurfaceSupportKHR(physical_device,i,surface,&surface_support);
+            if(surface_support) choice.graphics_family = i;
+        }
+    }
+    if(choice.graphics_family == -1u){
+        rejection = surface != VK_NULL_HANDLE ? "no graphics family can present to the surface" : "no graphics family";
+        return false;
+    }
+
+    //a compute family without graphics runs alongside rendering, a transfer-only family is the copy engine on discrete cards
+    choice.compute_family = choice.transfer_family = choice.graphics_family;
+    for(unsigned int i = 0; i < queue_family_count; ++i){
+        VkQueueFlags flags = queue_families[i].queueFlags;
+        if(choice.compute_family == choice.graphics_family && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) choice.compute_family = i;
+        if(choice.transfer_family == choice.graphics_family && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT|VK_QUEUE_COMPUTE_BIT))) choice.transfer_family = i;
+    }
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device,&memory_properties);
+    VkDeviceSize device_local = 0;
+    for(unsigned int i = 0; i < memory_properties.memoryHeapCount; ++i){
+        if(memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) device_local = max(device_local,memory_properties.memoryHeaps[i].size);
+    }
+
+    int type_score = device_type_score(properties.deviceType);
+    int compute_score = choice.compute_family != choice.graphics_family ? 100 : 0;
+    int transfer_score = choice.transfer_family != choice.graphics_family ? 100 : 0;
+    //a point per 256 MiB of the largest device-local heap, capped at 64 GiB so memory never outweighs the device type
+    unsigned int device_local_mib = device_local >> 20;
+    int memory_score = min(device_local_mib/256,256u);
+    int image_score = properties.limits.maxImageDimension2D/1024;
+    int timestamp_score = properties.limits.timestampComputeAndGraphics ? 50 : 0;
+    choice.score = type_score+compute_score+transfer_score+memory_score+image_score+timestamp_score;
+
+    char reason[512];
+    snprintf(reason,sizeof(reason),"%s +%d, %s compute family +%d, %s transfer family +%d, %u MiB device-local +%d, max 2D image %u +%d, %s +%d",
+        device_type_name(properties.deviceType),type_score,compute_score ? "dedicated" : "no dedicated",compute_score,transfer_score ? "dedicated" : "no dedicated",transfer_score,
+        device_local_mib,memory_score,properties.limits.maxImageDimension2D,image_score,timestamp_score ? "timestamps on all queues" : "no timestamps on all queues",timestamp_score);
+    choice.reason = reason;
+    return true;
+}
+
+device_choice select_physical_device(VkInstance instance, VkSurfaceKHR surface, const vector<const char*> &required_extensions, const char *device_override, FILE *log){
+    unsigned int physical_device_count;
+    vkEnumeratePhysicalDevices(instance,&physical_device_count,nullptr);
+    vector<VkPhysicalDevice> physical_devices(physical_device_count);
+    vkEnumeratePhysicalDevices(instance,&physical_device_count,physical_devices.data());
+    if(!physical_device_count) throw runtime_error("No Vulkan devices found");
+
+    device_choice best {};
+    bool found = false;
+    unsigned int usable = 0;
+    for(unsigned int i = 0; i < physical_device_count; ++i){
+        device_choice choice {};
+        string rejection;
+        bool suitable = evaluate_device(physical_devices[i],surface,required_extensions,choice,rejection);
+
+        VkPhysicalDeviceIDProperties id_properties {};
+        id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        id_properties.pNext = nullptr;
+        VkPhysicalDeviceProperties2 properties2 {};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &id_properties;
+        //deviceUUID is core in 1.1, older devices are rejected anyway and just show a zero UUID
+        if(choice.properties.apiVersion >= VK_API_VERSION_1_1) vkGetPhysicalDeviceProperties2(physical_devices[i],&properties2);
+        string uuid = uuid_string(id_properties.deviceUUID);
+
+        bool wanted = !device_override || matches_override(device_override,choice.properties.deviceName,uuid);
+        if(log){
+            if(suitable) fprintf(log,"device %u: %s [%s] score %d: %s%s\n",i,choice.properties.deviceName,uuid.c_str(),choice.score,choice.reason.c_str(),wanted ? "" : " (not matched by override)");
+            else fprintf(log,"device %u: %s [%s] rejected: %s\n",i,choice.properties.deviceName,uuid.c_str(),rejection.c_str());
+        }
+        if(!suitable || !wanted) continue;
+        ++usable;
+        if(!found || choice.score > best.score){
+            best = choice;
+            found = true;
+        }
+    }
+
+    if(!found) throw runtime_error(device_override ? string("No usable device matches override ")+device_override : string("No suitable Vulkan device found"));
+    best.reason = "highest score of "+to_string(usable)+(device_override ? string(" usable devices matching override \"")+device_override+"\"" : " usable of "+to_string(physical_device_count)+" devices")+
+        ", score "+to_string(best.score)+": "+best.reason;
+    return best;
+}
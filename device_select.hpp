@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct device_choice{
+    VkPhysicalDevice physical_device;
+    VkPhysicalDeviceProperties properties;
+    //graphics_family can present to the surface, compute and transfer fall back to it when the device has no dedicated family
+    unsigned int graphics_family, compute_family, transfer_family;
+    int score;
+    //why this device won, printed with benchmark results so they can be traced back to the hardware that ran them
+    std::string reason;
+};
+
+//scores every physical device by type, dedicated compute and transfer families, device-local memory and limits, rejecting
+//devices below Vulkan 1.2, without a graphics family that can present to surface (when given) or missing required_extensions
+//device_override (--device or $TRIANGLE_DEVICE) picks the device whose name contains it, ignoring case, or whose deviceUUID
+//it spells in hex, dashes optional, e.g. "llvmpipe" to force lavapipe on a machine that also has a GPU
+//every candidate and its score or rejection is written to log, throws runtime_error when nothing is usable
+device_choice select_physical_device(VkInstance instance, VkSurfaceKHR surface, const std::vector<const char*> &required_extensions, const char *device_override, FILE *log);
@@ -0,0 +1,49 @@
+#include "frame_pacer.hpp"
+#include "profiler.hpp"
+#include <stdexcept>
+using namespace std;
+
+frame_pacer::frame_pacer(queue_timeline &graphics, unsigned int frames_in_flight, bool low_latency) : graphics(graphics), low_latency(low_latency), slot_values(frames_in_flight,0) {
+    if(!frames_in_flight) throw runtime_error("At least one frame in flight required");
+}
+
+void frame_pacer::begin_frame(){
+    //uploads share the graphics timeline when there is no separate transfer family, so the depth counts the frames whose own
+    //values have not completed rather than the distance between submitted and completed values
+    uint64_t completed = graphics.completed();
+    unsigned int depth = 0;
+    for(uint64_t value : slot_values) depth += value > completed;
+    uint64_t begin = frame_profiler::now_ns();
+    graphics.wait(low_latency ? last_frame_value : slot_values[current_slot]);
+    slot_stall_ns += frame_profiler::now_ns()-begin;
+
+    ++frames;
+    depth_sum += depth;
+    if(depth > max_depth) max_depth = depth;
+}
+
+void frame_pacer::claim_image(unsigned int image_index){
+    if(image_index >= image_values.size()) image_values.resize(image_index+1,0);
+    uint64_t begin = frame_profiler::now_ns();
+    graphics.wait(image_values[image_index]);
+    image_stall_ns += frame_profiler::now_ns()-begin;
+    claimed_image = image_index;
+}
+
+void frame_pacer::reset_images(unsigned int image_count){
+    image_values.assign(image_count,0);
+    claimed_image = -1u;
+}
+
+void frame_pacer::submitted(uint64_t value){
+    slot_values[current_slot] = last_frame_value = value;
+    if(claimed_image != -1u) image_values[claimed_image] = value;
+    claimed_image = -1u;
+    current_slot = (current_slot+1)%slot_values.size();
+}
+
+void frame_pacer::report(FILE *out) const{
+    double per_frame = frames ? 1e6*frames : 1;
+    fprintf(out,"frame pacing: %s, %u frames in flight, queue depth mean %.2f max %u, stalled %.3f ms/frame on frame slots and %.3f ms/frame on swapchain images\n",
+        low_latency ? "latency" : "throughput",(unsigned int)slot_values.size(),frames ? (double)depth_sum/frames : 0.0,max_depth,slot_stall_ns/per_frame,image_stall_ns/per_frame);
+}
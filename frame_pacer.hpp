@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "timeline.hpp"
+
+//remembers the graphics timeline value each frame slot and each swapchain image was last submitted with, so a frame never
+//renders into an image an older frame is still using, whatever the ratio of images to frames in flight
+//throughput mode only waits for the frame that last used the current slot, keeping up to frames_in_flight frames queued,
+//latency mode drains the queue before the frame samples input, trading throughput for the freshest input on screen
+class frame_pacer{
+public:
+    frame_pacer(queue_timeline &graphics, unsigned int frames_in_flight, bool low_latency);
+
+    unsigned int frames_in_flight() const { return slot_values.size(); }
+    unsigned int slot() const { return current_slot; }
+
+    //call before sampling input for the frame
+    void begin_frame();
+    //waits for any older frame still rendering into image_index, call once the image is acquired
+    void claim_image(unsigned int image_index);
+    //forgets the table after the swapchain is recreated
+    void reset_images(unsigned int image_count);
+    //records the timeline value the frame was submitted with and moves on to the next slot
+    void submitted(uint64_t value);
+
+    void report(FILE *out) const;
+
+private:
+    queue_timeline &graphics;
+    bool low_latency;
+    std::vector<uint64_t> slot_values, image_values;
+    uint64_t last_frame_value = 0;
+    unsigned int current_slot = 0, claimed_image = -1u;
+
+    uint64_t frames = 0, depth_sum = 0, slot_stall_ns = 0, image_stall_ns = 0;
+    unsigned int max_depth = 0;
+};
@@ -0,0 +1,213 @@
+#include "gpu_allocator.hpp"
+#include <stdexcept>
+using namespace std;
+
+gpu_allocator::gpu_allocator(VkPhysicalDevice physical_device, VkDevice logical_device, VkDeviceSize block_size) : logical_device(logical_device) {
+    vkGetPhysicalDeviceMemoryProperties(physical_device,&memory_properties);
+    this->block_size = min_block_size;
+    while(this->block_size < block_size) this->block_size <<= 1;
+    max_order = 0;
+    while((min_block_size<<max_order) < this->block_size) ++max_order;
+}
+
+unsigned int gpu_allocator::find_memory_type(unsigned int type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const{
+    unsigned int fallback = -1u;
+    for(unsigned int i = 0; i < memory_properties.memoryTypeCount; ++i){
+        VkMemoryPropertyFlags flags = memory_properties.memoryTypes[i].propertyFlags;
+        if(!(type_bits & (1u<<i)) || (flags & required) != required) continue;
+        if((flags & preferred) == preferred) return i;
+        if(fallback == -1u) fallback = i;
+    }
+    if(fallback == -1u) throw runtime_error("No suitable memory type");
+    return fallback;
+}
+
+unsigned int gpu_allocator::order_for(VkDeviceSize size) const{
+    unsigned int order = 0;
+    while((min_block_size<<order) < size) ++order;
+    return order;
+}
+
+VkDeviceMemory gpu_allocator::allocate_memory(VkDeviceSize size, unsigned int memory_type, void **mapped){
+    VkMemoryAllocateInfo memory_info {};
+    memory_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memory_info.pNext = nullptr;
+    memory_info.allocationSize = size;
+    memory_info.memoryTypeIndex = memory_type;
+
+    VkDeviceMemory memory;
+    if(vkAllocateMemory(logical_device,&memory_info,nullptr,&memory)!=VK_SUCCESS) throw runtime_error("Error allocating device memory");
+    ++counters.vk_allocate_calls;
+
+    *mapped = nullptr;
+    if((memory_type_flags(memory_type) & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && vkMapMemory(logical_device,memory,0,VK_WHOLE_SIZE,0,mapped)!=VK_SUCCESS){
+        vkFreeMemory(logical_device,memory,nullptr);
+        throw runtime_error("Error mapping device memory");
+    }
+    return memory;
+}
+
+bool gpu_allocator::allocate_from(buddy_block &block, unsigned int order, VkDeviceSize &offset){
+    unsigned int available = order;
+    while(available <= max_order && block.free_lists[available].empty()) ++available;
+    if(available > max_order) return false;
+
+    offset = *block.free_lists[available].begin();
+    block.free_lists[available].erase(block.free_lists[available].begin());
+    //split down, handing the upper half back at every level
+    while(available > order){
+        --available;
+        block.free_lists[available].insert(offset+(min_block_size<<available));
+    }
+    block.live.insert({offset,order});
+    return true;
+}
+
+gpu_allocation gpu_allocator::allocate(const VkMemoryRequirements &requirements, bool linear, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred){
+    gpu_allocation allocation;
+    unsigned int memory_type = find_memory_type(requirements.memoryTypeBits,required,preferred);
+    allocation.size = requirements.size;
+
+    if(requirements.size > block_size/2){
+        allocation.memory = allocate_memory(requirements.size,memory_type,&allocation.mapped);
+        allocation.dedicated = true;
+        ++counters.dedicated_count;
+    }else{
+        unsigned int pool_index = 0;
+        while(pool_index < pools.size() && (pools[pool_index].memory_type != memory_type || pools[pool_index].linear != linear)) ++pool_index;
+        if(pool_index == pools.size()) pools.push_back({memory_type,linear,{}});
+        memory_pool &pool = pools[pool_index];
+
+        //buddy offsets are aligned to their own size, so rounding up to the alignment satisfies it too
+        unsigned int order = order_for(max(requirements.size,requirements.alignment));
+        unsigned int block_index = 0;
+        VkDeviceSize offset;
+        while(block_index < pool.blocks.size() && !allocate_from(*pool.blocks[block_index],order,offset)) ++block_index;
+        if(block_index == pool.blocks.size()){
+            unique_ptr<buddy_block> block(new buddy_block);
+            block->memory = allocate_memory(block_size,memory_type,&block->mapped);
+            block->free_lists.resize(max_order+1);
+            block->free_lists[max_order].insert(0);
+            pool.blocks.push_back(move(block));
+            ++counters.block_count;
+            counters.block_bytes += block_size;
+            allocate_from(*pool.blocks.back(),order,offset);
+        }
+
+        buddy_block &block = *pool.blocks[block_index];
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped)+offset : nullptr;
+        allocation.pool = pool_index;
+        allocation.block = block_index;
+    }
+
+    ++counters.allocation_count;
+    counters.allocated_bytes += allocation.size;
+    counters.peak_allocated_bytes = max(counters.peak_allocated_bytes,counters.allocated_bytes);
+    return allocation;
+}
+
+void gpu_allocator::free(const gpu_allocation &allocation){
+    if(allocation.memory == VK_NULL_HANDLE) return;
+    --counters.allocation_count;
+    counters.allocated_bytes -= allocation.size;
+
+    if(allocation.dedicated){
+        vkFreeMemory(logical_device,allocation.memory,nullptr);
+        --counters.dedicated_count;
+        return;
+    }
+
+    buddy_block &block = *pools[allocation.pool].blocks[allocation.block];
+    auto live = block.live.lower_bound({allocation.offset,0});
+    if(live == block.live.end() || live->first != allocation.offset) throw runtime_error("Freeing memory that was not allocated");
+    unsigned int order = live->second;
+    block.live.erase(live);
+
+    //merge with the buddy for as long as it is free
+    VkDeviceSize offset = allocation.offset;
+    while(order < max_order){
+        VkDeviceSize buddy = offset^(min_block_size<<order);
+        auto free_buddy = block.free_lists[order].find(buddy);
+        if(free_buddy == block.free_lists[order].end()) break;
+        block.free_lists[order].erase(free_buddy);
+        offset = min(offset,buddy);
+        ++order;
+    }
+    block.free_lists[order].insert(offset);
+}
+
+gpu_buffer gpu_allocator::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred){
+    VkBufferCreateInfo buffer_info {};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.pNext = nullptr;
+    buffer_info.flags = 0;
+    buffer_info.size = size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    buffer_info.queueFamilyIndexCount = 0;
+    buffer_info.pQueueFamilyIndices = nullptr;
+
+    gpu_buffer result;
+    if(vkCreateBuffer(logical_device,&buffer_info,nullptr,&result.buffer)!=VK_SUCCESS) throw runtime_error("Error creating buffer");
+    VkMemoryRequirements memory_requirements;
+    vkGetBufferMemoryRequirements(logical_device,result.buffer,&memory_requirements);
+    result.allocation = allocate(memory_requirements,true,required,preferred);
+    if(vkBindBufferMemory(logical_device,result.buffer,result.allocation.memory,result.allocation.offset)!=VK_SUCCESS) throw runtime_error("Error binding buffer memory");
+    return result;
+}
+
+void gpu_allocator::destroy_buffer(const gpu_buffer &buffer){
+    vkDestroyBuffer(logical_device,buffer.buffer,nullptr);
+    free(buffer.allocation);
+}
+
+gpu_image gpu_allocator::create_image(const VkImageCreateInfo &image_info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred){
+    gpu_image result;
+    if(vkCreateImage(logical_device,&image_info,nullptr,&result.image)!=VK_SUCCESS) throw runtime_error("Error creating image");
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(logical_device,result.image,&memory_requirements);
+    result.allocation = allocate(memory_requirements,image_info.tiling == VK_IMAGE_TILING_LINEAR,required,preferred);
+    if(vkBindImageMemory(logical_device,result.image,result.allocation.memory,result.allocation.offset)!=VK_SUCCESS) throw runtime_error("Error binding image memory");
+    return result;
+}
+
+void gpu_allocator::destroy_image(const gpu_image &image){
+    vkDestroyImage(logical_device,image.image,nullptr);
+    free(image.allocation);
+}
+
+void gpu_allocator::report(FILE *out) const{
+    fprintf(out,"device memory: %llu allocations, %.2f MiB live (peak %.2f MiB) in %llu blocks of %.2f MiB, %llu dedicated, %llu vkAllocateMemory calls\n",
+        (unsigned long long)counters.allocation_count,counters.allocated_bytes/1048576.0,counters.peak_allocated_bytes/1048576.0,
+        (unsigned long long)counters.block_count,counters.block_bytes/1048576.0,(unsigned long long)counters.dedicated_count,(unsigned long long)counters.vk_allocate_calls);
+}
+
+void gpu_allocator::destroy(){
+    for(memory_pool &pool : pools){
+        for(auto &block : pool.blocks) vkFreeMemory(logical_device,block->memory,nullptr);
+    }
+    pools.clear();
+    counters.block_count = counters.block_bytes = 0;
+}
+
+frame_arena::frame_arena(gpu_allocator &allocator, VkDeviceSize bytes_per_frame, unsigned int slot_count, VkBufferUsageFlags usage) : allocator(allocator), bytes_per_frame((max(bytes_per_frame,(VkDeviceSize)1)+255)&~(VkDeviceSize)255) {
+    storage = allocator.create_buffer(this->bytes_per_frame*slot_count,usage,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void frame_arena::begin_frame(unsigned int slot){
+    begin = cursor = slot*bytes_per_frame;
+}
+
+arena_allocation frame_arena::allocate(VkDeviceSize size, VkDeviceSize alignment){
+    VkDeviceSize offset = (cursor+alignment-1)/alignment*alignment;
+    if(offset+size > begin+bytes_per_frame) throw runtime_error("Frame arena exhausted");
+    cursor = offset+size;
+    return {storage.buffer,offset,static_cast<char*>(storage.allocation.mapped)+offset};
+}
+
+void frame_arena::destroy(){
+    allocator.destroy_buffer(storage);
+    storage = gpu_buffer();
+}
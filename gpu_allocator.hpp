@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct gpu_allocation{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0, size = 0;
+    //persistent mapping of offset, nullptr unless the memory type is host visible
+    void *mapped = nullptr;
+    unsigned int pool = 0, block = 0;
+    bool dedicated = false;
+};
+
+struct gpu_buffer{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    gpu_allocation allocation;
+};
+
+struct gpu_image{
+    VkImage image = VK_NULL_HANDLE;
+    gpu_allocation allocation;
+};
+
+struct gpu_allocator_stats{
+    uint64_t block_count = 0, block_bytes = 0;
+    uint64_t allocation_count = 0, allocated_bytes = 0, peak_allocated_bytes = 0;
+    uint64_t dedicated_count = 0, vk_allocate_calls = 0;
+};
+
+//sub-allocates long-lived resources out of large vkAllocateMemory blocks with a buddy allocator, so resource count is not bounded by
+//maxMemoryAllocationCount, requests bigger than half a block get their own dedicated allocation
+class gpu_allocator{
+public:
+    gpu_allocator(VkPhysicalDevice physical_device, VkDevice logical_device, VkDeviceSize block_size = 64ull<<20);
+
+    //picks a memory type with all required flags out of type_bits, preferring one that also has the preferred flags
+    unsigned int find_memory_type(unsigned int type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const;
+    VkMemoryPropertyFlags memory_type_flags(unsigned int memory_type) const { return memory_properties.memoryTypes[memory_type].propertyFlags; }
+
+    //linear is true for buffers and linear images, false for optimal tiling images, the two never share a block so
+    //bufferImageGranularity never has to be padded for
+    gpu_allocation allocate(const VkMemoryRequirements &requirements, bool linear, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+    void free(const gpu_allocation &allocation);
+
+    gpu_buffer create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+    void destroy_buffer(const gpu_buffer &buffer);
+    gpu_image create_image(const VkImageCreateInfo &image_info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+    void destroy_image(const gpu_image &image);
+
+    const gpu_allocator_stats &stats() const { return counters; }
+    void report(FILE *out) const;
+
+    //frees every block, all resources must already be destroyed
+    void destroy();
+
+private:
+    //power of two sized blocks, split and merged in units of min_block_size
+    struct buddy_block{
+        VkDeviceMemory memory;
+        void *mapped;
+        //free offsets per order, order k covers min_block_size<<k bytes
+        std::vector<std::set<VkDeviceSize>> free_lists;
+        //order of each live allocation keyed by offset
+        std::set<std::pair<VkDeviceSize,unsigned int>> live;
+    };
+    struct memory_pool{
+        unsigned int memory_type;
+        bool linear;
+        std::vector<std::unique_ptr<buddy_block>> blocks;
+    };
+
+    unsigned int order_for(VkDeviceSize size) const;
+    bool allocate_from(buddy_block &block, unsigned int order, VkDeviceSize &offset);
+    VkDeviceMemory allocate_memory(VkDeviceSize size, unsigned int memory_type, void **mapped);
+
+    static const VkDeviceSize min_block_size = 256;
+
+    VkDevice logical_device;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    VkDeviceSize block_size;
+    unsigned int max_order;
+    std::vector<memory_pool> pools;
+    gpu_allocator_stats counters;
+};
+
+struct arena_allocation{
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void *mapped;
+};
+
+//per-frame transient data: one persistently mapped buffer split into a region per frame slot, allocation is a pointer bump
+//and a slot's region is recycled wholesale by begin_frame once the slot's last frame has completed
+class frame_arena{
+public:
+    frame_arena(gpu_allocator &allocator, VkDeviceSize bytes_per_frame, unsigned int slot_count, VkBufferUsageFlags usage);
+
+    void begin_frame(unsigned int slot);
+    //throws if the current frame's region is exhausted
+    arena_allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    VkBuffer handle() const { return storage.buffer; }
+    void destroy();
+
+private:
+    gpu_allocator &allocator;
+    gpu_buffer storage;
+    VkDeviceSize bytes_per_frame, begin = 0, cursor = 0;
+};
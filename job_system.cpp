@@ -0,0 +1,66 @@
+#include "job_system.hpp"
+#include <utility>
+using namespace std;
+
+worker_pool::worker_pool(unsigned int thread_count){
+    for(unsigned int i = 1; i < thread_count; ++i) threads.emplace_back(&worker_pool::work,this,i);
+}
+
+worker_pool::~worker_pool(){
+    {
+        lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    start.notify_all();
+    for(thread &worker : threads) worker.join();
+}
+
+void worker_pool::drain(unsigned int worker_index){
+    for(unsigned int job = next_job.fetch_add(1,memory_order_relaxed); job < job_count; job = next_job.fetch_add(1,memory_order_relaxed)){
+        try{
+            (*current_job)(job,worker_index);
+        } catch(...){
+            lock_guard<std::mutex> lock(state_mutex);
+            if(!failure) failure = current_exception();
+        }
+    }
+}
+
+void worker_pool::work(unsigned int worker_index){
+    unsigned int seen_generation = 0;
+    while(1){
+        {
+            unique_lock<std::mutex> lock(state_mutex);
+            start.wait(lock,[&]{ return stopping || generation != seen_generation; });
+            if(stopping) return;
+            seen_generation = generation;
+        }
+        drain(worker_index);
+        {
+            lock_guard<std::mutex> lock(state_mutex);
+            if(--busy_workers == 0) finished.notify_one();
+        }
+    }
+}
+
+void worker_pool::run(unsigned int count, const function<void(unsigned int,unsigned int)> &job){
+    if(!count) return;
+    if(threads.empty() || count == 1){
+        for(unsigned int i = 0; i < count; ++i) job(i,0);
+        return;
+    }
+    {
+        lock_guard<std::mutex> lock(state_mutex);
+        current_job = &job;
+        job_count = count;
+        next_job.store(0,memory_order_relaxed);
+        busy_workers = threads.size();
+        ++generation;
+    }
+    start.notify_all();
+    drain(0);
+    unique_lock<std::mutex> lock(state_mutex);
+    finished.wait(lock,[&]{ return busy_workers == 0; });
+    current_job = nullptr;
+    if(failure) rethrow_exception(exchange(failure,nullptr));
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//fixed pool of worker threads running fork-join batches, the calling thread joins in as worker 0
+class worker_pool{
+public:
+    explicit worker_pool(unsigned int thread_count);
+    ~worker_pool();
+    worker_pool(const worker_pool&) = delete;
+    worker_pool &operator=(const worker_pool&) = delete;
+
+    unsigned int size() const { return threads.size()+1; }
+
+    //runs job(job_index, worker_index) for every job_index in [0,job_count) and returns once all have finished,
+    //jobs are handed out one at a time so uneven jobs still balance, worker_index is stable per thread,
+    //the first exception thrown by a job is rethrown here once the batch has drained
+    void run(unsigned int job_count, const std::function<void(unsigned int,unsigned int)> &job);
+
+private:
+    void work(unsigned int worker_index);
+    void drain(unsigned int worker_index);
+
+    std::vector<std::thread> threads;
+    std::mutex state_mutex;
+    std::condition_variable start, finished;
+    const std::function<void(unsigned int,unsigned int)> *current_job = nullptr;
+    unsigned int job_count = 0, generation = 0, busy_workers = 0;
+    std::atomic<unsigned int> next_job {0};
+    bool stopping = false;
+    std::exception_ptr failure;
+};
@@ -1,17 +1,42 @@
 #include <iostream>
+#include <cstring>
+#include <optional>
+#include <cmath>
+#include <cstddef>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
 #include <vulkan/vulkan.h>
+#include "options.hpp"
+#include "benchmark.hpp"
+#include "profiler.hpp"
+#include "pipeline_cache.hpp"
+#include "pipeline_manager.hpp"
+#include "shader_cache.hpp"
+#include "parallel_recorder.hpp"
+#include "gpu_allocator.hpp"
+#include "upload.hpp"
+#include "scene.hpp"
+#include "swapchain.hpp"
+#include "render_graph.hpp"
+#include "descriptors.hpp"
+#include "materials.hpp"
+#include "device_select.hpp"
+#include "timeline.hpp"
+#include "particle_compute.hpp"
+#include "frame_pacer.hpp"
+#include "capture.hpp"
 using namespace std;
 
-FILE *debug_file = fopen("debug.txt","w");
+//validation builds can enable VK_LAYER_KHRONOS_validation and the debug messenger, release builds compile both out
+#ifndef TRIANGLE_VALIDATION
+#define TRIANGLE_VALIDATION 1
+#endif
 
-VKAPI_ATTR VkBool32 VKAPI_CALL debug_messenger_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_flags ,const VkDebugUtilsMessengerCallbackDataEXT *callback_data, void *user_data){
-    fprintf(debug_file,"%s\n",callback_data->pMessage);
-    fflush(debug_file);
-    return VK_FALSE;
-}
+#if TRIANGLE_VALIDATION
+#include "async_logger.hpp"
+#endif
 
+#if TRIANGLE_VALIDATION
 VkResult create_debug_messenger(VkInstance instance, VkDebugUtilsMessengerCreateInfoEXT *debug_messenger_info ,const VkAllocationCallbacks *allocator, VkDebugUtilsMessengerEXT *debug_messenger){
     auto function = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance,"vkCreateDebugUtilsMessengerEXT");
     if(function) return function(instance,debug_messenger_info,allocator,debug_messenger);
@@ -23,37 +48,82 @@ void destroy_debug_messenger(VkInstance instance ,VkDebugUtilsMessengerEXT debug
     function(instance,debug_messenger,allocator);
 }
 
-VkShaderModule load_shader(const char *shaderpath, VkDevice logical_device){
-    FILE *file = fopen(shaderpath,"rb");
-    if(!file) throw runtime_error("Error opening shader path");
-    fseek(file,0,SEEK_END);
-    unsigned int size = ftell(file);
-    fseek(file,0,SEEK_SET);
-    char data[size];
-    fread(data,1,size,file);
-    VkShaderModuleCreateInfo module_info {};
-    module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    module_info.pNext = nullptr;
-    module_info.pCode = reinterpret_cast<unsigned int*>(data);
-    module_info.flags = 0;
-    module_info.codeSize = size;
-    VkShaderModule shadermodule;
-    if(vkCreateShaderModule(logical_device,&module_info,nullptr,&shadermodule)!=VK_SUCCESS) throw runtime_error("Error creating shader module");
-    fclose(file);
-    return shadermodule;
+bool instance_layer_available(const char *layer_name){
+    unsigned int layer_count;
+    vkEnumerateInstanceLayerProperties(&layer_count,nullptr);
+    VkLayerProperties layers[layer_count];
+    vkEnumerateInstanceLayerProperties(&layer_count,layers);
+    for(int i = 0; i < layer_count; ++i) if(!strcmp(layers[i].layerName,layer_name)) return true;
+    return false;
 }
+#endif
 
-int main(){
-    try{
-        SDL_Init(SDL_INIT_VIDEO);
-        const unsigned int window_width=500,window_height=500;
-        SDL_Window *window = SDL_CreateWindow("Test Triangle",0,0,window_width,window_height,SDL_WINDOW_VULKAN);
+struct vertex{
+    float position[2];
+    float color[3];
+};
 
-        unsigned int instance_extension_count, instance_layer_count = 1;
-        SDL_Vulkan_GetInstanceExtensions(window,&instance_extension_count,nullptr);
-        const char *instance_extensions[instance_extension_count+1],*instance_layers[instance_layer_count] = {"VK_LAYER_KHRONOS_validation"};
-        SDL_Vulkan_GetInstanceExtensions(window,&instance_extension_count,instance_extensions);
-        instance_extensions[instance_extension_count++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+int main(int argc, char **argv){
+    //1 when a replay diverged or a baseline comparison found a regression, -1 on errors
+    int exit_code = 0;
+    try{
+        app_options options = parse_options(argc,argv);
+        //a replay runs the captured workload whatever the command line asked for, so the timings stay comparable
+        optional<capture_stream> replay;
+        if(options.replay_path){
+            replay = capture_stream::load(options.replay_path);
+            const capture_settings &captured = replay->settings;
+            options.width = captured.width;
+            options.height = captured.height;
+            options.draws = captured.draws;
+            options.materials = captured.materials;
+            options.frames_in_flight = captured.frames_in_flight;
+            options.indirect_draws = captured.indirect_draws;
+            options.bindless = captured.bindless;
+            options.fragment_color_mode = (color_mode)captured.color_mode;
+            options.async_compute = captured.async_compute;
+            options.low_latency = captured.low_latency;
+            options.presentation_policy = (present_policy)captured.presentation_policy;
+            options.frames = replay->frames.size();
+            printf("replay: %zu frames from %s\n",replay->frames.size(),options.replay_path);
+        }
+        //loaded up front so a missing or mismatched baseline fails before the run rather than after it
+        optional<capture_stream> baseline;
+        if(options.baseline_path) baseline = capture_stream::load(options.baseline_path);
+        const bool headless = options.headless;
+        const unsigned int window_width=options.width,window_height=options.height;
+        SDL_Window *window = nullptr;
+
+#if TRIANGLE_VALIDATION
+        const char *validation_layer = "VK_LAYER_KHRONOS_validation";
+        bool validation = options.validation;
+        if(validation && !instance_layer_available(validation_layer)){
+            cerr << "Validation layer not installed, running without it\n";
+            validation = false;
+        }
+        optional<async_logger> logger;
+        if(validation) logger.emplace("debug.txt",parse_log_severity(options.log_level));
+#else
+        const bool validation = false;
+        if(options.validation) cerr << "Validation requested but this is a release build, running without it\n";
+#endif
+        const char *build_variant = TRIANGLE_VALIDATION ? (validation ? "validation build, layer on" : "validation build, layer off") : "release build";
+
+        unsigned int instance_extension_count = 0, instance_layer_count = validation ? 1 : 0;
+        if(!headless){
+            SDL_Init(SDL_INIT_VIDEO);
+            window = SDL_CreateWindow("Test Triangle",0,0,window_width,window_height,SDL_WINDOW_VULKAN|SDL_WINDOW_RESIZABLE);
+            if(!window) throw runtime_error(string("Error creating window: ")+SDL_GetError());
+            SDL_Vulkan_GetInstanceExtensions(window,&instance_extension_count,nullptr);
+        }
+        const char *instance_extensions[instance_extension_count+1],*instance_layers[1] = {nullptr};
+        if(!headless) SDL_Vulkan_GetInstanceExtensions(window,&instance_extension_count,instance_extensions);
+#if TRIANGLE_VALIDATION
+        if(validation){
+            instance_layers[0] = validation_layer;
+            instance_extensions[instance_extension_count++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+        }
+#endif
 
         VkApplicationInfo app_info {};
         app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -64,21 +134,28 @@ int main(){
         app_info.apiVersion = VK_API_VERSION_1_2;
         app_info.pNext = nullptr;
 
+#if TRIANGLE_VALIDATION
         VkDebugUtilsMessengerCreateInfoEXT debug_messenger_info {};
         debug_messenger_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
         debug_messenger_info.pNext = nullptr;
-        debug_messenger_info.pUserData = nullptr;
-        debug_messenger_info.pfnUserCallback = debug_messenger_callback;
+        debug_messenger_info.pUserData = validation ? &*logger : nullptr;
+        debug_messenger_info.pfnUserCallback = async_logger::debug_messenger_callback;
         debug_messenger_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT|VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT| VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
-        debug_messenger_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT|VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT|   VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT|VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+        //every severity, the logger drops what is below its level in the callback so the level can change at runtime
+        debug_messenger_info.messageSeverity = validation ? async_logger::all_severities : 0;
         debug_messenger_info.flags = 0;
+#endif
 
         VkInstanceCreateInfo instance_info {};
         instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         instance_info.ppEnabledLayerNames = instance_layers;
         instance_info.ppEnabledExtensionNames = instance_extensions;
         instance_info.pApplicationInfo = &app_info;
-        instance_info.pNext = &debug_messenger_info;
+#if TRIANGLE_VALIDATION
+        instance_info.pNext = validation ? &debug_messenger_info : nullptr;
+#else
+        instance_info.pNext = nullptr;
+#endif
         instance_info.flags = 0;
         instance_info.enabledLayerCount = instance_layer_count;
         instance_info.enabledExtensionCount = instance_extension_count;
@@ -86,487 +163,819 @@ int main(){
         VkInstance instance;
         if(vkCreateInstance(&instance_info,nullptr,&instance)!=VK_SUCCESS) throw runtime_error("Error creating instance");
 
-        VkDebugUtilsMessengerEXT debug_messenger;
-        if(create_debug_messenger(instance,&debug_messenger_info,nullptr,&debug_messenger)!=VK_SUCCESS) throw runtime_error("Error creating debug messenger");
-
-        unsigned int physical_device_count;
-        vkEnumeratePhysicalDevices(instance,&physical_device_count,nullptr);
-        VkPhysicalDevice physical_devices[physical_device_count];
-        vkEnumeratePhysicalDevices(instance,&physical_device_count,physical_devices);
+#if TRIANGLE_VALIDATION
+        VkDebugUtilsMessengerEXT debug_messenger = VK_NULL_HANDLE;
+        if(validation && create_debug_messenger(instance,&debug_messenger_info,nullptr,&debug_messenger)!=VK_SUCCESS) throw runtime_error("Error creating debug messenger");
+#endif
 
-        //TODO implement physical device selection
-        VkPhysicalDevice physical_device = physical_devices[0];
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+        if(!headless && !SDL_Vulkan_CreateSurface(window,instance,&surface)) throw runtime_error(string("Error creating surface: ")+SDL_GetError());
 
-        VkSurfaceKHR surface;
-        SDL_Vulkan_CreateSurface(window,instance,&surface);
+        vector<const char*> device_extensions;
+        if(!headless) device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+        //every candidate's score is printed on benchmark runs, so results can be traced back to the device that produced them
+        device_choice device = select_physical_device(instance,surface,device_extensions,options.device,headless || options.frame_limit ? stdout : nullptr);
+        VkPhysicalDevice physical_device = device.physical_device;
+        VkPhysicalDeviceProperties device_properties = device.properties;
 
         unsigned int queue_family_count;
         vkGetPhysicalDeviceQueueFamilyProperties(physical_device,&queue_family_count,nullptr);
         VkQueueFamilyProperties queue_families[queue_family_count];
         vkGetPhysicalDeviceQueueFamilyProperties(physical_device,&queue_family_count,queue_families);
 
-        unsigned int render_present_queue_index = -1;
-        for(int i = 0; i < queue_family_count; ++i){
-            if(queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT){
-                VkBool32 surface_support;
-                vkGetPhysicalDeviceSurfaceSupportKHR(physical_device,i,surface,&surface_support);
-
-                if(surface_support){
-                    render_present_queue_index = i;
-                    break;
-                }
-            }
-        }
-
-        if(render_present_queue_index<0) throw runtime_error("No Surface Support");
+        const unsigned int render_present_queue_index = device.graphics_family;
+        const unsigned int transfer_queue_index = device.transfer_family;
+        //without a separate compute family, or with --async-compute off, the particle pass runs on the graphics queue
+        const unsigned int compute_queue_index = options.async_compute ? device.compute_family : render_present_queue_index;
         
-        VkSurfaceCapabilitiesKHR surface_capabilities;
-        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device,surface,&surface_capabilities);
-
-        unsigned int present_mode_count;
-        vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device,surface,&present_mode_count,nullptr);
-        VkPresentModeKHR present_modes[present_mode_count];
-        vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device,surface,&present_mode_count,present_modes);
-
-        unsigned int surface_format_count;
-        vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device,surface,&surface_format_count,nullptr);
-        VkSurfaceFormatKHR surface_formats[surface_format_count];
-        vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device,surface,&surface_format_count,surface_formats);
-
-        VkPresentModeKHR present_mode;
-        for(int i = 0; i < present_mode_count; ++i){
-            if(present_modes[i] == VK_PRESENT_MODE_MAILBOX_KHR){
-                present_mode = present_modes[i];
-                goto skip_present;
-            }
-        }
-        present_mode = present_modes[0];
-        skip_present:;
-
-        VkSurfaceFormatKHR surface_format;
-        for(int i = 0; i < surface_format_count; ++i){
-            if(surface_formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR && surface_formats[i].format == VK_FORMAT_B8G8R8_SRGB){
-                surface_format = surface_formats[i];
-                goto skip_surface;
-            }
+        unsigned int present_mode_count = 0, surface_format_count = 0;
+        if(!headless){
+            vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device,surface,&present_mode_count,nullptr);
+            vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device,surface,&surface_format_count,nullptr);
         }
-        surface_format = surface_formats[0];
-        skip_surface:;
-
-        unsigned int min_swapchain_image_count = surface_capabilities.minImageCount;
-        VkExtent2D surface_extent;
-        if(surface_capabilities.currentExtent.width==UINT64_MAX){
-            surface_extent.width  = max(surface_capabilities.minImageExtent.width,min(surface_capabilities.maxImageExtent.width,window_width));
-            surface_extent.height = max(surface_capabilities.minImageExtent.height,min(surface_capabilities.maxImageExtent.height,window_height));
-        }else{  
-            surface_extent = surface_capabilities.currentExtent;
+        VkPresentModeKHR present_modes[present_mode_count+1];
+        VkSurfaceFormatKHR surface_formats[surface_format_count+1];
+        if(!headless){
+            vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device,surface,&present_mode_count,present_modes);
+            vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device,surface,&surface_format_count,surface_formats);
+        }else{
+            //the offscreen target has no surface to negotiate with, so it presents nothing and picks its own format
+            present_modes[0] = VK_PRESENT_MODE_FIFO_KHR;
+            surface_formats[0] = {VK_FORMAT_R8G8B8A8_SRGB,VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+            present_mode_count = surface_format_count = 1;
         }
 
+        present_policy presentation_policy = options.presentation_policy;
+        presentation present = choose_presentation(presentation_policy,present_modes,present_mode_count);
+        VkSurfaceFormatKHR surface_format = choose_surface_format(surface_formats,surface_format_count);
+
         float queue_priority = 1.0f;
-        VkDeviceQueueCreateInfo device_queue_info {};
-        device_queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        device_queue_info.pQueuePriorities = &queue_priority;
-        device_queue_info.queueCount = 1;
-        device_queue_info.queueFamilyIndex = render_present_queue_index; 
-        device_queue_info.pNext = nullptr;
-        device_queue_info.flags = 0;
+        //one queue per distinct family: graphics and present, the copy engine and async compute
+        const unsigned int queue_family_indices[3] = {render_present_queue_index,transfer_queue_index,compute_queue_index};
+        VkDeviceQueueCreateInfo device_queue_info[3] {};
+        unsigned int device_queue_count = 0;
+        for(unsigned int family : queue_family_indices){
+            bool created = false;
+            for(unsigned int i = 0; i < device_queue_count; ++i) created |= device_queue_info[i].queueFamilyIndex == family;
+            if(created) continue;
+            device_queue_info[device_queue_count].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            device_queue_info[device_queue_count].pQueuePriorities = &queue_priority;
+            device_queue_info[device_queue_count].queueCount = 1;
+            device_queue_info[device_queue_count].queueFamilyIndex = family;
+            device_queue_info[device_queue_count].pNext = nullptr;
+            device_queue_info[device_queue_count].flags = 0;
+            ++device_queue_count;
+        }
 
-        const unsigned int device_extension_count = 1;
-        const char *device_extensions[device_extension_count] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        //uploads signal a timeline semaphore, core in 1.2 but still opt-in
+        VkPhysicalDeviceVulkan12Features vulkan12_features {};
+        vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12_features.pNext = nullptr;
+        vulkan12_features.timelineSemaphore = VK_TRUE;
+
+        //instanced indirect commands start at their first visible object, which needs drawIndirectFirstInstance
+        VkPhysicalDeviceFeatures supported_features;
+        vkGetPhysicalDeviceFeatures(physical_device,&supported_features);
+        VkPhysicalDeviceFeatures enabled_features {};
+        enabled_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+        enabled_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+        bool indirect_draws = options.indirect_draws;
+        if(indirect_draws && !supported_features.drawIndirectFirstInstance){
+            cerr << "drawIndirectFirstInstance not supported, falling back to direct draws\n";
+            indirect_draws = false;
+        }
+
+        //materials are picked in the fragment shader with a push constant index, which is dynamic indexing of a sampler array
+        //even when the array holds one entry, bindless additionally needs partially bound, update-after-bind image arrays
+        if(!supported_features.shaderSampledImageArrayDynamicIndexing) throw runtime_error("shaderSampledImageArrayDynamicIndexing not supported");
+        enabled_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+        VkPhysicalDeviceVulkan12Features supported_vulkan12 {};
+        supported_vulkan12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        supported_vulkan12.pNext = nullptr;
+        VkPhysicalDeviceFeatures2 supported_features2 {};
+        supported_features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported_features2.pNext = &supported_vulkan12;
+        vkGetPhysicalDeviceFeatures2(physical_device,&supported_features2);
+        bool bindless = options.bindless;
+        if(bindless && !(supported_vulkan12.descriptorBindingPartiallyBound && supported_vulkan12.descriptorBindingSampledImageUpdateAfterBind)){
+            cerr << "descriptor indexing not supported, falling back to per-material descriptor sets\n";
+            bindless = false;
+        }
+        vulkan12_features.descriptorBindingPartiallyBound = bindless;
+        vulkan12_features.descriptorBindingSampledImageUpdateAfterBind = bindless;
 
         VkDeviceCreateInfo device_info {};
         device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        device_info.queueCreateInfoCount = 1;
-        device_info.pQueueCreateInfos = &device_queue_info;
+        device_info.queueCreateInfoCount = device_queue_count;
+        device_info.pQueueCreateInfos = device_queue_info;
         device_info.ppEnabledLayerNames = nullptr;
-        device_info.ppEnabledExtensionNames = device_extensions;
-        device_info.pNext = nullptr;
-        device_info.pEnabledFeatures = nullptr;
+        device_info.ppEnabledExtensionNames = device_extensions.data();
+        device_info.pNext = &vulkan12_features;
+        device_info.pEnabledFeatures = &enabled_features;
         device_info.flags = 0;
         device_info.enabledLayerCount = 0;
-        device_info.enabledExtensionCount = device_extension_count;
+        device_info.enabledExtensionCount = device_extensions.size();
 
         VkDevice logical_device;
         if(vkCreateDevice(physical_device,&device_info,nullptr,&logical_device)!=VK_SUCCESS) throw runtime_error("Error creating device");
 
-        VkPipelineVertexInputStateCreateInfo vertex_input {};
-        vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertex_input.pNext = nullptr;
-        vertex_input.pVertexAttributeDescriptions = nullptr;
-        vertex_input.pVertexBindingDescriptions = nullptr;
-        vertex_input.vertexAttributeDescriptionCount = 0;
-        vertex_input.vertexBindingDescriptionCount = 0;
-
-        VkPipelineInputAssemblyStateCreateInfo input_assembly {};
-        input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        input_assembly.flags = 0;
-        input_assembly.pNext = nullptr;
-        input_assembly.primitiveRestartEnable = VK_FALSE;
-        input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-
-        VkViewport viewport {};
-        viewport.height = surface_extent.height;
-        viewport.width = surface_extent.width;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        viewport.x = 0;
-        viewport.y = 0;
-
-        VkRect2D scissor {};
-        scissor.offset = {0,0};
-        scissor.extent = surface_extent;
-
-        VkPipelineViewportStateCreateInfo viewport_state {};
-        viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewport_state.viewportCount = 1;
-        viewport_state.scissorCount = 1;
-        viewport_state.pViewports = &viewport;
-        viewport_state.pScissors = &scissor;
-        viewport_state.pNext = nullptr;
-        viewport_state.flags = 0;
-
-        VkPipelineRasterizationStateCreateInfo rasterizer {};
-        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizer.pNext = nullptr;
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizer.flags = 0;
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.depthBiasEnable = VK_FALSE;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-
-        VkPipelineColorBlendAttachmentState color_blend_attachment {};
-        color_blend_attachment.blendEnable = VK_FALSE;
-        color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_A_BIT|VK_COLOR_COMPONENT_B_BIT|VK_COLOR_COMPONENT_G_BIT|VK_COLOR_COMPONENT_R_BIT;
-
-        VkPipelineColorBlendStateCreateInfo color_blend_state {};
-        color_blend_state.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        color_blend_state.pNext = nullptr;
-        color_blend_state.pAttachments = &color_blend_attachment;
-        color_blend_state.logicOpEnable = VK_FALSE;
-        color_blend_state.flags = 0;
-        color_blend_state.attachmentCount = 1;
-
-        VkPipelineMultisampleStateCreateInfo multisample_info {};
-        multisample_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisample_info.sampleShadingEnable = VK_FALSE;
-        multisample_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-        multisample_info.pSampleMask = nullptr;
-        multisample_info.pNext = nullptr;
-        multisample_info.minSampleShading = 0;
-        multisample_info.flags = 0;
-        multisample_info.alphaToOneEnable = VK_FALSE;
-        multisample_info.alphaToCoverageEnable = VK_FALSE;
-
-        VkAttachmentDescription attachment_description {};
-        attachment_description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-        attachment_description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        attachment_description.samples = VK_SAMPLE_COUNT_1_BIT;
-        attachment_description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        attachment_description.format = surface_format.format;
-        attachment_description.flags = 0;
-        attachment_description.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-        VkAttachmentReference attachment_reference {};
-        attachment_reference.attachment = 0;
-        attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-        VkSubpassDescription subpass_description {};
-        subpass_description.colorAttachmentCount = 1;
-        subpass_description.flags = 0;
-        subpass_description.pColorAttachments = &attachment_reference;
-        subpass_description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-
-        VkSubpassDependency subpass_dependency {};
-        subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        subpass_dependency.dstSubpass = 0;
-        subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        subpass_dependency.srcAccessMask = 0;
-        subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-        VkRenderPassCreateInfo renderpass_info {};
-        renderpass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderpass_info.subpassCount = 1;
-        renderpass_info.pSubpasses = &subpass_description;
-        renderpass_info.pNext = nullptr;
-        renderpass_info.pDependencies = &subpass_dependency;
-        renderpass_info.pAttachments = &attachment_description;
-        renderpass_info.flags = 0;
-        renderpass_info.dependencyCount = 1;
-        renderpass_info.pDependencies = &subpass_dependency;
-        renderpass_info.attachmentCount = 1;
-
-        VkRenderPass renderpass;
-        if(vkCreateRenderPass(logical_device,&renderpass_info,nullptr,&renderpass)!=VK_SUCCESS) throw runtime_error("Error creating renderpass");
+        gpu_allocator allocator(physical_device,logical_device);
+
+        //the frame as a render graph, the triangle pass is its first node and draws straight into the backbuffer, which is left ready
+        //to present (or to read back headless), record_triangles is filled in once the draw state exists
+        function<void(VkCommandBuffer)> record_triangles;
+        render_graph graph(logical_device,allocator);
+        const uint32_t backbuffer = graph.import_image("backbuffer",surface_format.format,headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        const uint32_t triangle_pass = graph.add_raster_pass("triangles",indirect_draws ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS,
+            [&](VkCommandBuffer commandbuffer){ record_triangles(commandbuffer); });
+        const VkClearColorValue clear_color = {{0,0,0,1}};
+        graph.write_color(triangle_pass,backbuffer,&clear_color);
+        graph.compile();
+
+        //every set layout comes from the cache, so the particle pass and a rebuilt pipeline share handles with these
+        descriptor_layout_cache layouts(logical_device);
+
+        //instance x, y and scale arrays, one storage buffer binding each, then the particle offsets at the frame slot's dynamic offset
+        vector<VkDescriptorSetLayoutBinding> instance_bindings(4);
+        for(int i = 0; i < 4; ++i){
+            instance_bindings[i].binding = i;
+            instance_bindings[i].descriptorType = i < 3 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+            instance_bindings[i].descriptorCount = 1;
+            instance_bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+            instance_bindings[i].pImmutableSamplers = nullptr;
+        }
+        VkDescriptorSetLayout instance_set_layout = layouts.get(instance_bindings);
+
+        //set 1 is either the bindless table holding every material or a single material's texture, rebound per material
+        optional<bindless_table> material_table;
+        if(bindless) material_table.emplace(logical_device,layouts,options.materials,VK_SHADER_STAGE_FRAGMENT_BIT);
+        VkDescriptorSet bindless_set = bindless ? material_table->set() : VK_NULL_HANDLE;
+        VkDescriptorSetLayoutBinding material_binding {};
+        material_binding.binding = 0;
+        material_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        material_binding.descriptorCount = 1;
+        material_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        material_binding.pImmutableSamplers = nullptr;
+        VkDescriptorSetLayout material_set_layout = bindless ? material_table->layout() : layouts.get({material_binding});
+        const VkDescriptorSetLayout set_layouts[2] = {instance_set_layout,material_set_layout};
+
+        //camera position for the vertex shader, the material index for the fragment shader
+        VkPushConstantRange push_constant_ranges[2] {};
+        push_constant_ranges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        push_constant_ranges[0].offset = 0;
+        push_constant_ranges[0].size = 2*sizeof(float);
+        push_constant_ranges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        push_constant_ranges[1].offset = 2*sizeof(float);
+        push_constant_ranges[1].size = sizeof(uint32_t);
 
         VkPipelineLayoutCreateInfo layout_info {};
         layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        layout_info.setLayoutCount = 0;
-        layout_info.pushConstantRangeCount = 0;
-        layout_info.pSetLayouts = nullptr;
-        layout_info.pPushConstantRanges = nullptr;
+        layout_info.setLayoutCount = 2;
+        layout_info.pushConstantRangeCount = 2;
+        layout_info.pSetLayouts = set_layouts;
+        layout_info.pPushConstantRanges = push_constant_ranges;
         layout_info.pNext = nullptr;
         layout_info.flags = 0;
 
         VkPipelineLayout pipeline_layout;
         if(vkCreatePipelineLayout(logical_device,&layout_info,nullptr,&pipeline_layout)!=VK_SUCCESS) throw runtime_error("Error creating pipeline layout");
 
-        VkShaderModule vs_module = load_shader("shader-bin/vs.spv",logical_device), fs_module = load_shader("shader-bin/fs.spv",logical_device);
-
-        VkPipelineShaderStageCreateInfo vs{},fs{};
-        vs.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vs.flags = 0;
-        vs.module = vs_module;
-        vs.pName = "main";
-        vs.pNext = nullptr;
-        vs.pSpecializationInfo = nullptr;
-        vs.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        
-        fs.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fs.flags = 0;
-        fs.module = fs_module;
-        fs.pName = "main";
-        fs.pNext = nullptr;
-        fs.pSpecializationInfo = nullptr;
-        fs.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        
-        VkPipelineShaderStageCreateInfo shader_stages[2] = {vs,fs};
-
-        VkGraphicsPipelineCreateInfo pipeline_info {};
-        pipeline_info.pInputAssemblyState = &input_assembly;
-        pipeline_info.pMultisampleState = &multisample_info;
-        pipeline_info.pNext = nullptr;
-        pipeline_info.pRasterizationState = &rasterizer;
-        pipeline_info.pStages = shader_stages;
-        pipeline_info.pTessellationState = nullptr;
-        pipeline_info.pVertexInputState = &vertex_input;
-        pipeline_info.pViewportState = &viewport_state;
-        pipeline_info.renderPass = renderpass;
-        pipeline_info.stageCount = 2;
-        pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipeline_info.subpass = 0;
-        pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
-        pipeline_info.basePipelineIndex = -1;
-        pipeline_info.layout = pipeline_layout;
-        pipeline_info.pColorBlendState = &color_blend_state;
-        pipeline_info.pDepthStencilState = nullptr;
-        pipeline_info.pDynamicState = nullptr;
-
-        VkPipeline pipeline;
-        if(vkCreateGraphicsPipelines(logical_device,VK_NULL_HANDLE,1,&pipeline_info,nullptr,&pipeline)!=VK_SUCCESS) throw runtime_error("Error creating pipeline");
-
-        VkSwapchainCreateInfoKHR swapchain_info {};
-        swapchain_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        swapchain_info.surface = surface;
-        swapchain_info.queueFamilyIndexCount = 1;
-        swapchain_info.preTransform = surface_capabilities.currentTransform;
-        swapchain_info.presentMode = present_mode;
-        swapchain_info.pQueueFamilyIndices = &render_present_queue_index;
-        swapchain_info.pNext = nullptr;
-        swapchain_info.oldSwapchain = VK_NULL_HANDLE;
-        swapchain_info.minImageCount = min_swapchain_image_count;
-        swapchain_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-        swapchain_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        swapchain_info.imageFormat = surface_format.format;
-        swapchain_info.imageExtent = surface_extent;
-        swapchain_info.imageColorSpace = surface_format.colorSpace;
-        swapchain_info.imageArrayLayers = 1;
-        swapchain_info.flags = 0;
-        swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        swapchain_info.clipped = VK_TRUE;
-
-        vkDestroyShaderModule(logical_device,vs_module,nullptr);
-        vkDestroyShaderModule(logical_device,fs_module,nullptr);
-        unsigned int swapchain_image_count;
-
-        VkSwapchainKHR swapchain;
-        if(vkCreateSwapchainKHR(logical_device,&swapchain_info,nullptr,&swapchain)!=VK_SUCCESS) throw runtime_error("Error creating swapchain");
-
-        vkGetSwapchainImagesKHR(logical_device,swapchain,&swapchain_image_count,nullptr);
-        VkImage swapchain_images[swapchain_image_count];
-        VkImageView swapchain_image_views[swapchain_image_count];
-        VkFramebuffer swapchain_framebuffers[swapchain_image_count];
-        vkGetSwapchainImagesKHR(logical_device,swapchain,&swapchain_image_count,swapchain_images);
-        
-        VkImageViewCreateInfo image_view_info {};
-        image_view_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        image_view_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        image_view_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        image_view_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-        image_view_info.flags = 0;
-        image_view_info.format = surface_format.format;
-        image_view_info.pNext = nullptr;
-        image_view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        image_view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        image_view_info.subresourceRange.baseArrayLayer = 0;
-        image_view_info.subresourceRange.baseMipLevel = 0;
-        image_view_info.subresourceRange.layerCount = 1;
-        image_view_info.subresourceRange.levelCount = 1;
-        image_view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-
-        VkFramebufferCreateInfo framebuffer_info {};
-        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebuffer_info.width = surface_extent.width;
-        framebuffer_info.renderPass = renderpass;
-        framebuffer_info.pNext = nullptr;
-        framebuffer_info.layers = 1;
-        framebuffer_info.height = surface_extent.height;
-        framebuffer_info.flags = 0;
-        framebuffer_info.attachmentCount = 1;
-
-        for(int i = 0; i < swapchain_image_count; ++i){
-            image_view_info.image = swapchain_images[i];
-            if(vkCreateImageView(logical_device,&image_view_info,nullptr,&swapchain_image_views[i])!=VK_SUCCESS) throw runtime_error("Error creating image view");
-            framebuffer_info.pAttachments = &swapchain_image_views[i];
-            if(vkCreateFramebuffer(logical_device,&framebuffer_info,nullptr,&swapchain_framebuffers[i])!=VK_SUCCESS) throw runtime_error("Error creating framebuffer");
+        shader_cache shaders(logical_device);
+
+        //the triangle's vertices, per-instance data is read from storage buffers by gl_InstanceIndex, opaque materials overwrite
+        //the attachment and translucent ones blend, everything else is shared by the two variants
+        pipeline_key opaque_key {};
+        opaque_key.renderpass = graph.render_pass(triangle_pass);
+        opaque_key.subpass = graph.subpass(triangle_pass);
+        opaque_key.layout = pipeline_layout;
+        opaque_key.vertex_shader = shaders.load("shader-bin/vs.spv");
+        opaque_key.fragment_shader = shaders.load("shader-bin/fs.spv");
+        //fragment variant: the material array holds the whole table when bindless and one texture otherwise, plus the color mode
+        opaque_key.fragment_variant.set(0,bindless ? options.materials : 1).set(1,(uint32_t)options.fragment_color_mode);
+        opaque_key.vertex_stride = sizeof(vertex);
+        opaque_key.attribute_count = 2;
+        opaque_key.attribute_formats[0] = VK_FORMAT_R32G32_SFLOAT;
+        opaque_key.attribute_offsets[0] = offsetof(vertex,position);
+        opaque_key.attribute_formats[1] = VK_FORMAT_R32G32B32_SFLOAT;
+        opaque_key.attribute_offsets[1] = offsetof(vertex,color);
+        opaque_key.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        opaque_key.polygon_mode = VK_POLYGON_MODE_FILL;
+        opaque_key.cull_mode = VK_CULL_MODE_BACK_BIT;
+        opaque_key.front_face = VK_FRONT_FACE_CLOCKWISE;
+        opaque_key.blend = VK_FALSE;
+        pipeline_key translucent_key = opaque_key;
+        translucent_key.blend = VK_TRUE;
+
+        pipeline_cache pipelines(logical_device,device_properties,options.pipeline_cache_path);
+        pipeline_manager graphics_pipelines(logical_device,pipelines.handle());
+        uint64_t pipeline_begin_ns = frame_profiler::now_ns();
+        VkPipeline pipeline = graphics_pipelines.get(opaque_key);
+        uint64_t pipeline_end_ns = frame_profiler::now_ns();
+        //only the opaque pipeline is waited for, translucent materials draw with it until their variant is ready
+        graphics_pipelines.request(translucent_key,pipeline);
+
+        const unsigned int frames_in_flight = options.frames_in_flight;
+
+        //headless renders into one offscreen image per frame in flight instead of a swapchain
+        swapchain_manager swapchain(physical_device,logical_device,allocator,surface,surface_format,present.present_mode,render_present_queue_index,
+            headless ? frames_in_flight : present.extra_images);
+        //every frame's inputs and timings, kept when they are written out, replayed or compared, frame_input is the frame being
+        //recorded and collects the events that happen ahead of it
+        optional<capture_stream> recording;
+        if(options.capture_path || options.replay_path || options.baseline_path){
+            recording.emplace();
+            capture_settings &settings = recording->settings;
+            settings.width = window_width;
+            settings.height = window_height;
+            settings.draws = options.draws;
+            settings.materials = options.materials;
+            settings.frames_in_flight = frames_in_flight;
+            settings.indirect_draws = options.indirect_draws;
+            settings.bindless = options.bindless;
+            settings.color_mode = (uint8_t)options.fragment_color_mode;
+            settings.async_compute = options.async_compute;
+            settings.low_latency = options.low_latency;
+            settings.presentation_policy = (uint8_t)options.presentation_policy;
+            if(baseline && !(baseline->settings == settings)) throw runtime_error(string("Baseline ")+options.baseline_path+" was captured with different settings");
         }
-
+        captured_frame frame_input;
+
+        //headless runs only change extent when a replay resizes
+        VkExtent2D headless_extent = {window_width,window_height};
+        auto drawable_extent = [&]() -> VkExtent2D {
+            if(headless) return headless_extent;
+            int width, height;
+            SDL_Vulkan_GetDrawableSize(window,&width,&height);
+            return {(unsigned int)width,(unsigned int)height};
+        };
+        if(!swapchain.recreate(drawable_extent(),0)) throw runtime_error("Error creating swapchain: window has no area");
+        graph.resize(swapchain.extent(),0);
+        frame_input.events |= capture_resize;
+        frame_input.width = swapchain.extent().width;
+        frame_input.height = swapchain.extent().height;
+
+        //one transient pool per frame in flight, reset once the slot's last frame has completed, so commands are re-recorded every frame
+        //while the memory behind them is reused rather than freed and reallocated
         VkCommandPoolCreateInfo commandpool_info {};
         commandpool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         commandpool_info.queueFamilyIndex = render_present_queue_index;
         commandpool_info.pNext = nullptr;
-        commandpool_info.flags = 0;
+        commandpool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        VkCommandPool commandpools[frames_in_flight];
+        VkCommandBuffer commandbuffers[frames_in_flight];
+        for(int i = 0; i < frames_in_flight; ++i){
+            if(vkCreateCommandPool(logical_device,&commandpool_info,nullptr,&commandpools[i])!=VK_SUCCESS) throw runtime_error("Error creating command pool");
+
+            VkCommandBufferAllocateInfo allocate_info {};
+            allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocate_info.pNext = nullptr;
+            allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocate_info.commandPool = commandpools[i];
+            allocate_info.commandBufferCount = 1;
+            if(vkAllocateCommandBuffers(logical_device,&allocate_info,&commandbuffers[i])!=VK_SUCCESS) throw runtime_error("Error allocating command buffers"); 
+        }
+
+        //each frame slot's command buffer brackets its render pass with its own pair of timestamps
+        frame_profiler profiler(logical_device,device_properties,queue_families[render_present_queue_index],frames_in_flight);
+        profiler.record_cpu(pipelines.warm() ? "vkCreateGraphicsPipelines (warm cache)" : "vkCreateGraphicsPipelines (cold cache)",0,pipeline_begin_ns,pipeline_end_ns);
+
+        VkQueue render_present_queue,transfer_queue,compute_queue;
+        vkGetDeviceQueue(logical_device,render_present_queue_index,0,&render_present_queue);
+        vkGetDeviceQueue(logical_device,transfer_queue_index,0,&transfer_queue);
+        vkGetDeviceQueue(logical_device,compute_queue_index,0,&compute_queue);
+        //every queue gets one timeline semaphore, the transfer family only needs its own when it is a separate queue
+        queue_timeline graphics_timeline(logical_device,render_present_queue);
+        optional<queue_timeline> separate_transfer_timeline;
+        if(transfer_queue != render_present_queue) separate_transfer_timeline.emplace(logical_device,transfer_queue);
+        queue_timeline &transfer_timeline = separate_transfer_timeline ? *separate_transfer_timeline : graphics_timeline;
+        optional<queue_timeline> compute_timeline;
+        if(compute_queue != render_present_queue) compute_timeline.emplace(logical_device,compute_queue);
+        upload_queue uploads(logical_device,allocator,device_properties,transfer_queue_index,transfer_timeline,render_present_queue_index);
+
+        //long-lived vertex data lives in device local memory and is streamed in through the upload queue
+        const vertex triangle[3] = {
+            {{-0.5f, 0.5f},{1,0,0}},
+            {{ 0.0f,-0.5f},{0,1,0}},
+            {{ 0.5f, 0.5f},{0,0,1}}
+        };
+        const uint16_t triangle_indices[3] = {0,1,2};
+        gpu_buffer vertex_buffer = allocator.create_buffer(sizeof(triangle),VK_BUFFER_USAGE_VERTEX_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        gpu_buffer index_buffer = allocator.create_buffer(sizeof(triangle_indices),VK_BUFFER_USAGE_INDEX_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        uploads.upload_buffer(vertex_buffer.buffer,0,triangle,sizeof(triangle),VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        uploads.upload_buffer(index_buffer.buffer,0,triangle_indices,sizeof(triangle_indices),VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,VK_ACCESS_INDEX_READ_BIT);
+
+        //the scene is options.draws triangles, their x, y and scale arrays packed one after another in a single storage buffer
+        instanced_scene scene(options.draws,options.materials);
+        const VkDeviceSize storage_alignment = max<VkDeviceSize>(device_properties.limits.minStorageBufferOffsetAlignment,4);
+        const VkDeviceSize instance_array_size = (max(scene.size(),1u)*sizeof(float)+storage_alignment-1)/storage_alignment*storage_alignment;
+        gpu_buffer instance_buffer = allocator.create_buffer(3*instance_array_size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        const vector<float> *instance_arrays[3] = {&scene.instance_x(),&scene.instance_y(),&scene.instance_scale()};
+        if(scene.size()){
+            for(int i = 0; i < 3; ++i) uploads.upload_buffer(instance_buffer.buffer,i*instance_array_size,instance_arrays[i]->data(),scene.size()*sizeof(float),VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT);
+        }
 
-        VkCommandPool commandpool;
-        if(vkCreateCommandPool(logical_device,&commandpool_info,nullptr,&commandpool)!=VK_SUCCESS) throw runtime_error("Error creating command pool");
+        material_library materials(logical_device,allocator,uploads,scene.materials());
+        if(bindless) for(unsigned int i = 0; i < materials.size(); ++i) material_table->add(materials.view(i),materials.sampler());
+
+        //sets that live as long as the device: the instance set and the particle pass's set
+        descriptor_allocator static_sets(logical_device,{{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,3},{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,1}},2);
+        particle_compute particles(logical_device,allocator,device_properties,shaders,pipelines.handle(),layouts,static_sets,compute_timeline ? &*compute_timeline : nullptr,compute_queue_index,
+            render_present_queue_index,scene.size(),scene.drift(),frames_in_flight);
+        uint32_t particle_offset = 0;
+        float particle_time = 0;
+
+        VkDescriptorSet instance_set = static_sets.allocate(instance_set_layout);
+
+        VkDescriptorBufferInfo instance_buffer_info[4];
+        VkWriteDescriptorSet instance_writes[4] {};
+        for(int i = 0; i < 4; ++i){
+            instance_buffer_info[i].buffer = i < 3 ? instance_buffer.buffer : particles.buffer();
+            instance_buffer_info[i].offset = i < 3 ? i*instance_array_size : 0;
+            instance_buffer_info[i].range = i < 3 ? instance_array_size : particles.slot_size();
+            instance_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            instance_writes[i].pNext = nullptr;
+            instance_writes[i].dstSet = instance_set;
+            instance_writes[i].dstBinding = i;
+            instance_writes[i].dstArrayElement = 0;
+            instance_writes[i].descriptorCount = 1;
+            instance_writes[i].descriptorType = instance_bindings[i].descriptorType;
+            instance_writes[i].pImageInfo = nullptr;
+            instance_writes[i].pBufferInfo = &instance_buffer_info[i];
+            instance_writes[i].pTexelBufferView = nullptr;
+        }
+        vkUpdateDescriptorSets(logical_device,4,instance_writes,0,nullptr);
+
+        //per-frame indirect commands, a slot's region is only rewritten after the slot's last frame has completed
+        frame_arena indirect_arena(allocator,max(scene.size(),1u)*sizeof(VkDrawIndexedIndirectCommand),frames_in_flight,VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        VkDeviceSize indirect_offset = 0;
+        unsigned int indirect_count = 0;
+        vector<VkDrawIndexedIndirectCommand> indirect_list;
+        indirect_list.reserve(scene.size());
+        vector<material_run> material_runs;
+        uint64_t visible_objects = 0, indirect_commands = 0;
+        float camera[2] = {0,0};
+
+        //the direct path splits one vkCmdDraw per visible object across the worker threads as secondary command buffers
+        vector<draw_item> draws;
+        worker_pool workers(options.threads);
+        parallel_recorder recorder(logical_device,render_present_queue_index,workers,frames_in_flight);
+        auto bind_state = [&](VkCommandBuffer commandbuffer){
+            vkCmdBindPipeline(commandbuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline);
+            VkDeviceSize vertex_offset = 0;
+            vkCmdBindVertexBuffers(commandbuffer,0,1,&vertex_buffer.buffer,&vertex_offset);
+            vkCmdBindIndexBuffer(commandbuffer,index_buffer.buffer,0,VK_INDEX_TYPE_UINT16);
+            vkCmdBindDescriptorSets(commandbuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline_layout,0,1,&instance_set,1,&particle_offset);
+            if(bindless) vkCmdBindDescriptorSets(commandbuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline_layout,1,1,&bindless_set,0,nullptr);
+            vkCmdPushConstants(commandbuffer,pipeline_layout,VK_SHADER_STAGE_VERTEX_BIT,0,sizeof(camera),camera);
+
+            VkExtent2D extent = swapchain.extent();
+            VkViewport viewport {};
+            viewport.height = extent.height;
+            viewport.width = extent.width;
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            viewport.x = 0;
+            viewport.y = 0;
+            vkCmdSetViewport(commandbuffer,0,1,&viewport);
+
+            VkRect2D scissor {};
+            scissor.offset = {0,0};
+            scissor.extent = extent;
+            vkCmdSetScissor(commandbuffer,0,1,&scissor);
+        };
+
+        //without bindless every material the frame draws gets a set from the slot's allocator, which is reset as the slot comes
+        //around again, so steady state allocation is a pool reset plus a handful of writes
+        vector<descriptor_allocator> material_allocators;
+        for(unsigned int i = 0; i < frames_in_flight; ++i) material_allocators.emplace_back(logical_device,vector<VkDescriptorPoolSize>{{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1}},64);
+        vector<VkDescriptorSet> material_sets(materials.size());
+        uint64_t material_set_allocations = 0;
+        auto prepare_materials = [&](unsigned int slot){
+            if(bindless) return;
+            descriptor_allocator &frame_sets = material_allocators[slot];
+            frame_sets.reset();
+            fill(material_sets.begin(),material_sets.end(),VK_NULL_HANDLE);
+            auto write_material = [&](unsigned int material){
+                if(material_sets[material] != VK_NULL_HANDLE) return;
+                material_sets[material] = frame_sets.allocate(material_set_layout);
+
+                VkDescriptorImageInfo image_info {};
+                image_info.sampler = materials.sampler();
+                image_info.imageView = materials.view(material);
+                image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+                VkWriteDescriptorSet write {};
+                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.pNext = nullptr;
+                write.dstSet = material_sets[material];
+                write.dstBinding = 0;
+                write.dstArrayElement = 0;
+                write.descriptorCount = 1;
+                write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                write.pImageInfo = &image_info;
+                write.pBufferInfo = nullptr;
+                write.pTexelBufferView = nullptr;
+                vkUpdateDescriptorSets(logical_device,1,&write,0,nullptr);
+            };
+            if(indirect_draws) for(const material_run &run : material_runs) write_material(run.material);
+            else for(const draw_item &draw : draws) write_material(draw.material);
+            material_set_allocations += frame_sets.allocated();
+        };
+        //the frame's pipeline per blend mode, resolved on this thread before recording so workers only read it
+        VkPipeline frame_pipelines[2] = {pipeline,pipeline};
+        //bindless pushes the table index, otherwise the material's own set is bound and always read at index 0
+        auto bind_material = [&](VkCommandBuffer commandbuffer, unsigned int material){
+            vkCmdBindPipeline(commandbuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,frame_pipelines[materials.translucent(material)]);
+            uint32_t index = material;
+            if(!bindless){
+                vkCmdBindDescriptorSets(commandbuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline_layout,1,1,&material_sets[material],0,nullptr);
+                index = 0;
+            }
+            vkCmdPushConstants(commandbuffer,pipeline_layout,VK_SHADER_STAGE_FRAGMENT_BIT,2*sizeof(float),sizeof(index),&index);
+        };
+
+        //culls against the frame's camera into either the slot's indirect command list or the direct draw list
+        auto cull_frame = [&](unsigned int slot, unsigned int frame){
+            if(replay) copy(begin(replay->frames[frame].camera),end(replay->frames[frame].camera),camera);
+            else scene.camera_at(frame,camera);
+            if(indirect_draws){
+                visible_objects += scene.cull_indirect(camera,indirect_list,material_runs);
+                indirect_count = indirect_list.size();
+                indirect_commands += indirect_count;
+                //the arena mapping is write-combined, so the list is culled in cached memory and copied over sequentially,
+                //nothing reads the mapping back
+                indirect_arena.begin_frame(slot);
+                arena_allocation commands = indirect_arena.allocate(max(indirect_count,1u)*sizeof(VkDrawIndexedIndirectCommand),sizeof(VkDrawIndexedIndirectCommand));
+                memcpy(commands.mapped,indirect_list.data(),indirect_count*sizeof(VkDrawIndexedIndirectCommand));
+                indirect_offset = commands.offset;
+                if(recording){
+                    frame_input.draw_count = indirect_count;
+                    frame_input.draw_hash = hash_draws(indirect_list.data(),indirect_count*sizeof(VkDrawIndexedIndirectCommand));
+                }
+            }else{
+                scene.cull_direct(camera,draws);
+                visible_objects += draws.size();
+                if(recording){
+                    frame_input.draw_count = draws.size();
+                    frame_input.draw_hash = hash_draws(draws.data(),draws.size()*sizeof(draw_item));
+                }
+            }
+        };
 
-        VkCommandBufferAllocateInfo allocate_info {};
-        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocate_info.pNext = nullptr;
-        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocate_info.commandPool = commandpool;
-        allocate_info.commandBufferCount = swapchain_image_count;
+        if(options.record_benchmark){
+            graph.bind_image(backbuffer,swapchain.view(0));
+            record_scaling_benchmark(stdout,logical_device,render_present_queue_index,graph.render_pass(triangle_pass),graph.framebuffer(triangle_pass),bind_state);
+        }
 
-        VkCommandBuffer commandbuffers[swapchain_image_count];
-        if(vkAllocateCommandBuffers(logical_device,&allocate_info,commandbuffers)!=VK_SUCCESS) throw runtime_error("Error allocating command buffers"); 
+        //the triangle pass, the direct path's secondaries are recorded by record_frame before the graph runs
+        const vector<VkCommandBuffer> *secondaries = nullptr;
+        record_triangles = [&](VkCommandBuffer commandbuffer){
+            //the indirect path is a handful of commands, recorded inline
+            if(indirect_draws){
+                bind_state(commandbuffer);
+                //one multi-draw per run of commands sharing a material
+                for(const material_run &run : material_runs){
+                    bind_material(commandbuffer,run.material);
+                    VkDeviceSize run_offset = indirect_offset+run.first_command*sizeof(VkDrawIndexedIndirectCommand);
+                    if(enabled_features.multiDrawIndirect){
+                        vkCmdDrawIndexedIndirect(commandbuffer,indirect_arena.handle(),run_offset,run.command_count,sizeof(VkDrawIndexedIndirectCommand));
+                    }else for(unsigned int i = 0; i < run.command_count; ++i){
+                        vkCmdDrawIndexedIndirect(commandbuffer,indirect_arena.handle(),run_offset+i*sizeof(VkDrawIndexedIndirectCommand),1,sizeof(VkDrawIndexedIndirectCommand));
+                    }
+                }
+            }else if(!secondaries->empty()) vkCmdExecuteCommands(commandbuffer,secondaries->size(),secondaries->data());
+        };
+
+        //only call once slot's last frame has completed, the slot's pools are reset and everything is recorded from scratch
+        auto record_frame = [&](unsigned int slot, unsigned int image_index){
+            if(vkResetCommandPool(logical_device,commandpools[slot],0)!=VK_SUCCESS) throw runtime_error("Error resetting command pool");
 
-        for(int i = 0; i < swapchain_image_count; ++i){
             VkCommandBufferBeginInfo begin_info {};
             begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
             begin_info.pNext = nullptr;
             begin_info.pInheritanceInfo = nullptr;
-            begin_info.flags = 0;
-
-            if(vkBeginCommandBuffer(commandbuffers[i],&begin_info)!=VK_SUCCESS) throw runtime_error("Error starting command buffer recording state");
-
-            VkRenderPassBeginInfo renderpass_begin {};
-            renderpass_begin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderpass_begin.renderPass = renderpass;
-            renderpass_begin.renderArea.offset = {0,0};
-            renderpass_begin.renderArea.extent = surface_extent;
-            renderpass_begin.pNext = nullptr;
-            VkClearValue clear_value {0,0,0,1};
-            renderpass_begin.pClearValues = &clear_value;
-            renderpass_begin.framebuffer = swapchain_framebuffers[i];
-            renderpass_begin.clearValueCount = 1;
-
-            vkCmdBeginRenderPass(commandbuffers[i],&renderpass_begin,VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandbuffers[i],VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline);
-            vkCmdDraw(commandbuffers[i],3,1,0,0);
-            vkCmdEndRenderPass(commandbuffers[i]);
-
-            if(vkEndCommandBuffer(commandbuffers[i])!=VK_SUCCESS) throw runtime_error("Error ending command buffer recording state");
-        }
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-        VkSemaphoreCreateInfo semaphore_info {};
-        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        semaphore_info.pNext = nullptr;
-        semaphore_info.flags = 0;
+            VkCommandBufferInheritanceInfo inheritance_info {};
+            inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritance_info.pNext = nullptr;
+            graph.bind_image(backbuffer,swapchain.view(image_index));
+            inheritance_info.renderPass = graph.render_pass(triangle_pass);
+            inheritance_info.subpass = graph.subpass(triangle_pass);
+            inheritance_info.framebuffer = graph.framebuffer(triangle_pass);
+            inheritance_info.occlusionQueryEnable = VK_FALSE;
+            secondaries = indirect_draws ? nullptr : &recorder.record(slot,inheritance_info,bind_state,draws,bind_material);
 
-        unsigned int frames_in_flight = 2;
-        VkSemaphore image_available_semaphore[frames_in_flight],render_finished_semaphore[frames_in_flight];
+            if(vkBeginCommandBuffer(commandbuffers[slot],&begin_info)!=VK_SUCCESS) throw runtime_error("Error starting command buffer recording state");
 
-        for(int i = 0; i < frames_in_flight; ++i) if(vkCreateSemaphore(logical_device,&semaphore_info,nullptr,&image_available_semaphore[i])!=VK_SUCCESS || vkCreateSemaphore(logical_device,&semaphore_info,nullptr,&render_finished_semaphore[i])!=VK_SUCCESS) throw runtime_error("Error creating semaphores");
+            uploads.cmd_acquire(commandbuffers[slot]);
 
-        unsigned int frame_index = 0;
-        VkFenceCreateInfo fence_info {};
-        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+            profiler.cmd_begin(commandbuffers[slot],slot);
+            //inside the timed region, so the graphics queue time includes the dispatch when it is serialized
+            particles.cmd_consume(commandbuffers[slot],slot,particle_time);
 
-        VkFence fences[frames_in_flight];
-        for(int i = 0; i < frames_in_flight; ++i) if(vkCreateFence(logical_device,&fence_info,nullptr,&fences[i])!=VK_SUCCESS) throw runtime_error("Error creating fence");
+            graph.execute(commandbuffers[slot]);
+            profiler.cmd_end(commandbuffers[slot],slot);
 
-        VkQueue render_present_queue;
-        vkGetDeviceQueue(logical_device,render_present_queue_index,0,&render_present_queue);
+            if(vkEndCommandBuffer(commandbuffers[slot])!=VK_SUCCESS) throw runtime_error("Error ending command buffer recording state");
+        };
+
+        VkSemaphoreCreateInfo semaphore_info {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext = nullptr;
+        semaphore_info.flags = 0;
+
+        //acquire semaphores belong to the frame slot, render finished ones to the image, since an image is only acquired again
+        //once the present waiting on its semaphore has consumed it, while a slot can come around before that
+        VkSemaphore image_available_semaphore[frames_in_flight];
+        for(int i = 0; i < frames_in_flight; ++i) if(vkCreateSemaphore(logical_device,&semaphore_info,nullptr,&image_available_semaphore[i])!=VK_SUCCESS) throw runtime_error("Error creating semaphores");
+        vector<VkSemaphore> render_finished_semaphores;
+        auto create_render_finished = [&](){
+            while(render_finished_semaphores.size() < swapchain.image_count()){
+                VkSemaphore semaphore;
+                if(vkCreateSemaphore(logical_device,&semaphore_info,nullptr,&semaphore)!=VK_SUCCESS) throw runtime_error("Error creating semaphores");
+                render_finished_semaphores.push_back(semaphore);
+            }
+        };
+        create_render_finished();
+
+        frame_pacer pacer(graphics_timeline,frames_in_flight,options.low_latency);
+
+        //the frame number, input sample time and submit time each frame slot last used, so its timestamps can be read back once the
+        //slot's timeline value is reached
+        unsigned int frame_number[frames_in_flight];
+        uint64_t frame_input_ns[frames_in_flight], frame_submit_ns[frames_in_flight];
+        for(int i = 0; i < frames_in_flight; ++i) frame_number[i] = -1u;
+        frame_stats stats(options.warmup_frames);
+        stats.set_pipeline_creation((pipeline_end_ns-pipeline_begin_ns)/1e6,pipelines.warm());
+        unsigned int frame_count = 0;
+        uint64_t frame_start = frame_profiler::now_ns();
+        const uint64_t run_begin_ns = frame_start;
+        uint64_t recorded_upload_bytes = 0;
+        unsigned int diverged_frames = 0, first_diverged_frame = 0;
+        //closes the frame's CPU timing and its captured record, a replayed frame whose draws or uploads differ from the
+        //capture's has diverged, which fails the run
+        auto end_frame = [&](){
+            uint64_t frame_end = frame_profiler::now_ns();
+            profiler.record_cpu("frame",frame_count,frame_start,frame_end);
+            stats.add_cpu_frame((frame_end-frame_start)/1e6);
+            if(recording){
+                copy(camera,camera+2,frame_input.camera);
+                frame_input.cpu_ms = (frame_end-frame_start)/1e6;
+                if(replay){
+                    const captured_frame &captured = replay->frames[frame_count];
+                    if(captured.draw_count != frame_input.draw_count || captured.draw_hash != frame_input.draw_hash || captured.upload_bytes != frame_input.upload_bytes){
+                        if(!diverged_frames++) first_diverged_frame = frame_count;
+                    }
+                }
+                recording->frames.push_back(frame_input);
+            }
+            frame_input = captured_frame();
+            frame_start = frame_end;
+            ++frame_count;
+        };
+        bool swapchain_dirty = false;
+        const bool frame_limit = headless || options.frame_limit;
         
         SDL_Event event;
         while(1){
-            while(SDL_PollEvent(&event)){
+            if(frame_limit && frame_count == options.frames) break;
+
+            //the wait comes before polling, so in latency mode input is sampled with the GPU already drained
+            const unsigned int frame_index = pacer.slot();
+            {
+                frame_profiler::scope timing(profiler,"vkWaitSemaphores",frame_count);
+                pacer.begin_frame();
+            }
+            if(frame_number[frame_index] != -1u){
+                uint64_t gpu_end_ns;
+                double gpu_ms = profiler.collect_gpu(frame_index,frame_number[frame_index],frame_submit_ns[frame_index],&gpu_end_ns);
+                if(gpu_ms >= 0){
+                    stats.add_gpu_frame(gpu_ms);
+                    if(recording) recording->frames[frame_number[frame_index]].gpu_ms = gpu_ms;
+                    stats.add_latency((gpu_end_ns-frame_input_ns[frame_index])/1e6);
+                }
+                frame_number[frame_index] = -1u;
+            }
+            swapchain.collect(graphics_timeline.completed());
+            graph.collect(graphics_timeline.completed());
+
+            if(!headless) while(SDL_PollEvent(&event)){
                 if(event.type == SDL_QUIT){
                     goto quit;
                     break;
                 }
+                if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) swapchain_dirty = true;
+                //the policy only changes the present mode and image count, so the render pass and pipeline survive the switch
+                if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p && !event.key.repeat){
+                    presentation_policy = next_present_policy(presentation_policy);
+                    present = choose_presentation(presentation_policy,present_modes,present_mode_count);
+                    swapchain.configure(present.present_mode,present.extra_images);
+                    swapchain_dirty = true;
+                    frame_input.events |= capture_present_policy;
+                    frame_input.presentation_policy = (uint8_t)presentation_policy;
+                    frame_input.present_mode = present.present_mode;
+                    printf("present policy: %s (%s)\n",present_policy_name(presentation_policy),present_mode_name(present.present_mode));
+                }
+            }
+            //a replay applies the captured events where a live run polls for them, offscreen images have no present mode, so a
+            //policy switch only changes what is reported
+            if(replay){
+                const captured_frame &input = replay->frames[frame_count];
+                if(input.events & capture_present_policy){
+                    presentation_policy = (present_policy)input.presentation_policy;
+                    frame_input.events |= capture_present_policy;
+                    frame_input.presentation_policy = input.presentation_policy;
+                    frame_input.present_mode = input.present_mode;
+                }
+                if(input.events & capture_resize){
+                    frame_input.events |= capture_resize;
+                    frame_input.width = input.width;
+                    frame_input.height = input.height;
+                    if(input.width != swapchain.extent().width || input.height != swapchain.extent().height){
+                        headless_extent = {input.width,input.height};
+                        swapchain_dirty = true;
+                    }
+                }
+            }
+            const uint64_t input_ns = frame_profiler::now_ns();
+
+            if(swapchain_dirty){
+                uint64_t recreate_begin = frame_profiler::now_ns();
+                if(!swapchain.recreate(drawable_extent(),graphics_timeline.submitted())){
+                    //there is no window or event queue to wait on offscreen, only a replayed resize gets here
+                    if(headless) throw runtime_error("Capture resizes to an empty extent");
+                    //minimized, sleep until the window changes instead of spinning
+                    SDL_WaitEvent(nullptr);
+                    continue;
+                }
+                graph.resize(swapchain.extent(),graphics_timeline.submitted());
+                frame_input.events |= capture_resize;
+                frame_input.width = swapchain.extent().width;
+                frame_input.height = swapchain.extent().height;
+                pacer.reset_images(swapchain.image_count());
+                create_render_finished();
+                profiler.record_cpu("swapchain recreate",frame_count,recreate_begin,frame_profiler::now_ns());
+                swapchain_dirty = false;
             }
-
-            vkWaitForFences(logical_device,1,&fences[frame_index],VK_TRUE,UINT64_MAX);
-            vkResetFences(logical_device,1,&fences[frame_index]);
 
             unsigned int image_index;
-            if(vkAcquireNextImageKHR(logical_device,swapchain,UINT64_MAX,image_available_semaphore[frame_index],VK_NULL_HANDLE,&image_index)!=VK_SUCCESS) throw runtime_error("Error acquiring image");
-
-            VkSubmitInfo submit_info {};
-            VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-            submit_info.commandBufferCount = 1;
-            submit_info.pCommandBuffers = &commandbuffers[image_index];
-            submit_info.pNext = nullptr;
-            submit_info.pSignalSemaphores = &render_finished_semaphore[frame_index];
-            submit_info.pWaitDstStageMask = wait_stages;
-            submit_info.pWaitSemaphores = &image_available_semaphore[frame_index];
-            submit_info.signalSemaphoreCount = 1;
-            submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-            submit_info.waitSemaphoreCount = 1;
-
-            if(vkQueueSubmit(render_present_queue,1,&submit_info,fences[frame_index])!=VK_SUCCESS) throw runtime_error("Error submitting queue");
+            if(headless) image_index = frame_index;
+            else{
+                frame_profiler::scope timing(profiler,"vkAcquireNextImageKHR",frame_count);
+                VkResult acquired = swapchain.acquire(image_available_semaphore[frame_index],image_index);
+                if(acquired == VK_ERROR_OUT_OF_DATE_KHR){
+                    swapchain_dirty = true;
+                    continue;
+                }
+                if(acquired == VK_SUBOPTIMAL_KHR) swapchain_dirty = true;
+            }
+            {
+                frame_profiler::scope timing(profiler,"image wait",frame_count);
+                pacer.claim_image(image_index);
+            }
+            frame_number[frame_index] = frame_count;
+            frame_input_ns[frame_index] = input_ns;
+
+            frame_input.upload_bytes = uploads.stats().bytes-recorded_upload_bytes;
+            recorded_upload_bytes = uploads.stats().bytes;
+            semaphore_wait upload_done = uploads.flush();
+            //the simulation advances by frame rather than wall time, so runs are reproducible
+            particle_offset = particles.slot_offset(frame_index);
+            particle_time = frame_count/60.0f;
+            semaphore_wait particles_done;
+            {
+                frame_profiler::scope timing(profiler,"compute submit",frame_count);
+                particles_done = particles.submit(frame_index,particle_time);
+            }
+            {
+                frame_profiler::scope timing(profiler,"cull",frame_count);
+                cull_frame(frame_index,frame_count);
+            }
+            {
+                frame_profiler::scope timing(profiler,"descriptor sets",frame_count);
+                prepare_materials(frame_index);
+            }
+            frame_pipelines[1] = graphics_pipelines.request(translucent_key,pipeline);
+            {
+                frame_profiler::scope timing(profiler,"record",frame_count);
+                record_frame(frame_index,image_index);
+            }
+
+            //offscreen images need no acquire/present handshake, so headless submits skip the binary semaphores,
+            //the upload timeline is only waited on when something new was flushed, the compute one whenever the dispatch is async
+            vector<semaphore_wait> waits;
+            if(!headless) waits.push_back({image_available_semaphore[frame_index],0,VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT});
+            if(upload_done.value) waits.push_back(upload_done);
+            if(particles_done.value) waits.push_back(particles_done);
+
+            frame_submit_ns[frame_index] = frame_profiler::now_ns();
+            {
+                frame_profiler::scope timing(profiler,"vkQueueSubmit",frame_count);
+                pacer.submitted(graphics_timeline.submit(commandbuffers[frame_index],waits,headless ? VK_NULL_HANDLE : render_finished_semaphores[image_index]));
+            }
+
+            if(headless){
+                end_frame();
+                continue;
+            }
         
-            VkPresentInfoKHR present_info {};
-            present_info.waitSemaphoreCount = 1;
-            present_info.swapchainCount = 1;
-            present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-            present_info.pWaitSemaphores = &render_finished_semaphore[frame_index];
-            present_info.pSwapchains = &swapchain;
-            present_info.pResults = nullptr;
-            present_info.pNext = nullptr;
-            present_info.pImageIndices = &image_index;
-            frame_index = ++frame_index%2;
-
-            if(vkQueuePresentKHR(render_present_queue,&present_info)!=VK_SUCCESS) throw runtime_error("Error presenting"); 
+            {
+                frame_profiler::scope timing(profiler,"vkQueuePresentKHR",frame_count);
+                if(swapchain.present(render_present_queue,render_finished_semaphores[image_index],image_index) != VK_SUCCESS) swapchain_dirty = true;
+            }
+            end_frame();
         }
         quit:;
 
         vkDeviceWaitIdle(logical_device);
-
-        for(int i = 0; i < frames_in_flight; ++i){
-        vkDestroySemaphore(logical_device,image_available_semaphore[i],nullptr);
-        vkDestroySemaphore(logical_device,render_finished_semaphore[i],nullptr);
-        vkDestroyFence(logical_device,fences[i],nullptr);
+        const uint64_t run_end_ns = frame_profiler::now_ns();
+
+        if(frame_limit && !options.record_benchmark){
+            stats.report(stdout,device_properties.deviceName,build_variant);
+            printf("device selection: %s\n",device.reason.c_str());
+            if(headless) printf("presentation: offscreen, %u images, %s policy\n",swapchain.image_count(),present_policy_name(presentation_policy));
+            else printf("presentation: %s, %u images, %s policy, %u swapchain recreates\n",present_mode_name(swapchain.mode()),swapchain.image_count(),
+                present_policy_name(presentation_policy),swapchain.recreate_count());
+            printf("draw path: %s, %u objects, %.1f visible and %.1f indirect commands per frame\n",indirect_draws ? "indirect" : "direct",scene.size(),
+                frame_count ? (double)visible_objects/frame_count : 0.0,frame_count ? (double)indirect_commands/frame_count : 0.0);
+            allocator.report(stdout);
+            uploads.report(stdout);
+            graphics_pipelines.report(stdout);
+            graph.report(stdout);
+            printf("shader variant: %s color mode\n",color_mode_name(options.fragment_color_mode));
+            pacer.report(stdout);
+            if(particles.async()) printf("async compute: on, family %u\n",compute_queue_index);
+            else printf("async compute: off, serialized on the graphics queue%s\n",options.async_compute ? " (no separate compute family)" : "");
+            if(bindless) printf("descriptors: bindless, %u materials in one set, %u set layouts cached (%u hits)\n",material_table->size(),layouts.misses,layouts.hits);
+            else{
+                unsigned int material_pools = 0;
+                for(const descriptor_allocator &frame_sets : material_allocators) material_pools += frame_sets.pool_count();
+                printf("descriptors: per-material sets%s, %u materials, %.1f sets per frame from %u pools, %u set layouts cached (%u hits)\n",options.bindless ? " (no descriptor indexing)" : "",
+                    materials.size(),frame_count ? (double)material_set_allocations/frame_count : 0.0,material_pools,layouts.misses,layouts.hits);
+            }
+            if(replay){
+                double seconds = (run_end_ns-run_begin_ns)/1e9;
+                printf("replay: %u frames in %.3f s, %.1f frames/s, %u diverged frames",frame_count,seconds,seconds > 0 ? frame_count/seconds : 0.0,diverged_frames);
+                if(diverged_frames) printf(" (first at frame %u)",first_diverged_frame);
+                printf("\n");
+            }
         }
+        if(options.trace_path) profiler.dump(options.trace_path);
+        bool regressed = false;
+        if(baseline) regressed = !compare_to_baseline(stdout,*recording,*baseline,options.warmup_frames,options.regression_threshold);
+        if(options.capture_path) recording->save(options.capture_path);
+        exit_code = regressed || diverged_frames ? 1 : 0;
+        profiler.destroy();
+
+        for(int i = 0; i < frames_in_flight; ++i) vkDestroySemaphore(logical_device,image_available_semaphore[i],nullptr);
+        for(VkSemaphore semaphore : render_finished_semaphores) vkDestroySemaphore(logical_device,semaphore,nullptr);
         
-        vkDestroyCommandPool(logical_device,commandpool,nullptr);
+        for(int i = 0; i < frames_in_flight; ++i) vkDestroyCommandPool(logical_device,commandpools[i],nullptr);
+        recorder.destroy();
         
-        for(int i = 0; i < swapchain_image_count; ++i){
-            vkDestroyImageView(logical_device,swapchain_image_views[i],nullptr);
-            vkDestroyFramebuffer(logical_device,swapchain_framebuffers[i],nullptr);
-        }
-        vkDestroySwapchainKHR(logical_device,swapchain,nullptr);        
-        vkDestroyPipeline(logical_device,pipeline,nullptr);
+        graph.destroy();
+        swapchain.destroy();
+        uploads.destroy();
+        if(separate_transfer_timeline) separate_transfer_timeline->destroy();
+        if(compute_timeline) compute_timeline->destroy();
+        graphics_timeline.destroy();
+        for(descriptor_allocator &frame_sets : material_allocators) frame_sets.destroy();
+        if(material_table) material_table->destroy();
+        static_sets.destroy();
+        particles.destroy();
+        materials.destroy();
+        indirect_arena.destroy();
+        allocator.destroy_buffer(instance_buffer);
+        allocator.destroy_buffer(index_buffer);
+        allocator.destroy_buffer(vertex_buffer);
+        allocator.destroy();
+        graphics_pipelines.destroy();
+        pipelines.save();
+        pipelines.destroy();
+        shaders.destroy();
         vkDestroyPipelineLayout(logical_device,pipeline_layout,nullptr);
-        vkDestroyRenderPass(logical_device,renderpass,nullptr);
+        layouts.destroy();
         vkDestroyDevice(logical_device,nullptr);
-        vkDestroySurfaceKHR(instance,surface,nullptr);
-        destroy_debug_messenger(instance,debug_messenger,nullptr);
+        if(!headless) vkDestroySurfaceKHR(instance,surface,nullptr);
+#if TRIANGLE_VALIDATION
+        if(validation) destroy_debug_messenger(instance,debug_messenger,nullptr);
+#endif
         vkDestroyInstance(instance,nullptr);
 
-        fclose(debug_file);
+#if TRIANGLE_VALIDATION
+        if(validation) logger->stop();
+#endif
     
-        SDL_DestroyWindow(window);
-        SDL_Quit();
+        if(!headless){
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+        }
     } catch(const exception &e){
         cerr << e.what() << '\n';
         return -1;
     }
-    return 0;
+    return exit_code;
 }   
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "materials.hpp"
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+using namespace std;
+
+static const unsigned int texture_size = 4;
+
+material_library::material_library(VkDevice logical_device, gpu_allocator &allocator, upload_queue &uploads, unsigned int count)
+    : logical_device(logical_device), allocator(allocator) {
+    VkImageCreateInfo image_info {};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.pNext = nullptr;
+    image_info.flags = 0;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_info.extent = {texture_size,texture_size,1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT|VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.queueFamilyIndexCount = 0;
+    image_info.pQueueFamilyIndices = nullptr;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkImageViewCreateInfo view_info {};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.pNext = nullptr;
+    view_info.flags = 0;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = image_info.format;
+    view_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.baseMipLevel = 0;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount = 1;
+
+    for(unsigned int i = 0; i < count; ++i){
+        //a checker of white and a hue spread evenly around the color wheel, so neighbouring materials are told apart on screen
+        float hue = 6.0f*i/count;
+        uint8_t tint[3];
+        for(int c = 0; c < 3; ++c){
+            float ramp = fabs(fmod(hue+6-2*c,6.0f)-3)-1;
+            tint[c] = 255*fmin(fmax(ramp,0.0f),1.0f);
+        }
+        uint8_t texels[texture_size*texture_size*4];
+        for(unsigned int t = 0; t < texture_size*texture_size; ++t){
+            bool white = (t%texture_size+t/texture_size)%2;
+            for(int c = 0; c < 3; ++c) texels[4*t+c] = white ? 255 : tint[c];
+            texels[4*t+3] = white || !translucent(i) ? 255 : 128;
+        }
+
+        gpu_image image = allocator.create_image(image_info,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        images.push_back(image);
+        uploads.upload_image(image.image,image_info.extent,texels,sizeof(texels),VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT);
+
+        view_info.image = image.image;
+        VkImageView view;
+        if(vkCreateImageView(logical_device,&view_info,nullptr,&view)!=VK_SUCCESS) throw runtime_error("Error creating material image view");
+        views.push_back(view);
+    }
+
+    VkSamplerCreateInfo sampler_info {};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.pNext = nullptr;
+    sampler_info.flags = 0;
+    sampler_info.magFilter = VK_FILTER_NEAREST;
+    sampler_info.minFilter = VK_FILTER_NEAREST;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.mipLodBias = 0;
+    sampler_info.anisotropyEnable = VK_FALSE;
+    sampler_info.maxAnisotropy = 1;
+    sampler_info.compareEnable = VK_FALSE;
+    sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+    sampler_info.minLod = 0;
+    sampler_info.maxLod = 0;
+    sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    sampler_info.unnormalizedCoordinates = VK_FALSE;
+    if(vkCreateSampler(logical_device,&sampler_info,nullptr,&texture_sampler)!=VK_SUCCESS) throw runtime_error("Error creating material sampler");
+}
+
+void material_library::destroy(){
+    vkDestroySampler(logical_device,texture_sampler,nullptr);
+    for(VkImageView view : views) vkDestroyImageView(logical_device,view,nullptr);
+    for(const gpu_image &image : images) allocator.destroy_image(image);
+    views.clear();
+    images.clear();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "gpu_allocator.hpp"
+#include "upload.hpp"
+
+//count procedural 4x4 checker textures standing in for material images, streamed in through the upload queue, each with its
+//own view, all sampled through one nearest-filtering sampler
+class material_library{
+public:
+    material_library(VkDevice logical_device, gpu_allocator &allocator, upload_queue &uploads, unsigned int count);
+
+    unsigned int size() const { return images.size(); }
+    VkImageView view(unsigned int i) const { return views[i]; }
+    VkSampler sampler() const { return texture_sampler; }
+    //every fourth material is drawn alpha blended, its tinted texels are partly transparent
+    bool translucent(unsigned int i) const { return i%4 == 3; }
+
+    void destroy();
+
+private:
+    VkDevice logical_device;
+    gpu_allocator &allocator;
+    std::vector<gpu_image> images;
+    std::vector<VkImageView> views;
+    VkSampler texture_sampler;
+};
@@ -0,0 +1,123 @@
+#include "options.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+static unsigned int parse_uint(const char *flag, const char *value){
+    if(!value) throw runtime_error(string("Missing value for ")+flag);
+    char *end;
+    unsigned long result = strtoul(value,&end,10);
+    if(*value=='\0' || *end!='\0') throw runtime_error(string("Invalid value for ")+flag+": "+value);
+    return result;
+}
+
+const char *color_mode_name(color_mode mode){
+    switch(mode){
+        case color_mode::texture: return "texture";
+        case color_mode::vertex: return "vertex";
+        default: return "modulate";
+    }
+}
+
+app_options parse_options(int argc, char **argv){
+    app_options options;
+    if(const char *log_level = getenv("TRIANGLE_LOG_LEVEL")) options.log_level = log_level;
+    if(const char *device = getenv("TRIANGLE_DEVICE")) options.device = device;
+    if(const char *validation = getenv("TRIANGLE_VALIDATION")) options.validation = strcmp(validation,"0") && strcmp(validation,"off");
+    for(int i = 1; i < argc; ++i){
+        const char *arg = argv[i], *value = i+1 < argc ? argv[i+1] : nullptr;
+        if(!strcmp(arg,"--headless")) options.headless = true;
+        else if(!strcmp(arg,"--record-benchmark")) options.record_benchmark = true;
+        else if(!strcmp(arg,"--draws")){ options.draws = parse_uint(arg,value); ++i; }
+        else if(!strcmp(arg,"--frames-in-flight")){
+            options.frames_in_flight = parse_uint(arg,value); ++i;
+            if(!options.frames_in_flight) throw runtime_error("Invalid value for --frames-in-flight: 0");
+        }
+        else if(!strcmp(arg,"--materials")){
+            options.materials = parse_uint(arg,value); ++i;
+            if(!options.materials) throw runtime_error("Invalid value for --materials: 0");
+        }
+        else if(!strcmp(arg,"--threads")){ options.threads = parse_uint(arg,value); ++i; }
+        else if(!strcmp(arg,"--frames")){ options.frames = parse_uint(arg,value); options.frame_limit = true; ++i; }
+        else if(!strcmp(arg,"--warmup")){ options.warmup_frames = parse_uint(arg,value); ++i; }
+        else if(!strcmp(arg,"--width")){ options.width = parse_uint(arg,value); ++i; }
+        else if(!strcmp(arg,"--height")){ options.height = parse_uint(arg,value); ++i; }
+        else if(!strcmp(arg,"--trace")){
+            if(!value) throw runtime_error("Missing value for --trace");
+            options.trace_path = value; ++i;
+        }
+        else if(!strcmp(arg,"--device")){
+            if(!value) throw runtime_error("Missing value for --device");
+            options.device = value; ++i;
+        }
+        else if(!strcmp(arg,"--pipeline-cache")){
+            if(!value) throw runtime_error("Missing value for --pipeline-cache");
+            options.pipeline_cache_path = value; ++i;
+        }
+        else if(!strcmp(arg,"--draw-path")){
+            if(!value) throw runtime_error("Missing value for --draw-path");
+            if(strcmp(value,"direct") && strcmp(value,"indirect")) throw runtime_error(string("Invalid value for --draw-path: ")+value);
+            options.indirect_draws = !strcmp(value,"indirect"); ++i;
+        }
+        else if(!strcmp(arg,"--async-compute")){
+            if(!value) throw runtime_error("Missing value for --async-compute");
+            if(strcmp(value,"on") && strcmp(value,"off")) throw runtime_error(string("Invalid value for --async-compute: ")+value);
+            options.async_compute = !strcmp(value,"on"); ++i;
+        }
+        else if(!strcmp(arg,"--bindless")){
+            if(!value) throw runtime_error("Missing value for --bindless");
+            if(strcmp(value,"on") && strcmp(value,"off")) throw runtime_error(string("Invalid value for --bindless: ")+value);
+            options.bindless = !strcmp(value,"on"); ++i;
+        }
+        else if(!strcmp(arg,"--color-mode")){
+            if(!value) throw runtime_error("Missing value for --color-mode");
+            if(!strcmp(value,"modulate")) options.fragment_color_mode = color_mode::modulate;
+            else if(!strcmp(value,"texture")) options.fragment_color_mode = color_mode::texture;
+            else if(!strcmp(value,"vertex")) options.fragment_color_mode = color_mode::vertex;
+            else throw runtime_error(string("Invalid value for --color-mode: ")+value);
+            ++i;
+        }
+        else if(!strcmp(arg,"--pacing")){
+            if(!value) throw runtime_error("Missing value for --pacing");
+            if(strcmp(value,"latency") && strcmp(value,"throughput")) throw runtime_error(string("Invalid value for --pacing: ")+value);
+            options.low_latency = !strcmp(value,"latency"); ++i;
+        }
+        else if(!strcmp(arg,"--present-policy")){
+            if(!value) throw runtime_error("Missing value for --present-policy");
+            options.presentation_policy = parse_present_policy(value); ++i;
+        }
+        else if(!strcmp(arg,"--capture")){
+            if(!value) throw runtime_error("Missing value for --capture");
+            options.capture_path = value; ++i;
+        }
+        else if(!strcmp(arg,"--replay")){
+            if(!value) throw runtime_error("Missing value for --replay");
+            options.replay_path = value; ++i;
+        }
+        else if(!strcmp(arg,"--baseline")){
+            if(!value) throw runtime_error("Missing value for --baseline");
+            options.baseline_path = value; ++i;
+        }
+        else if(!strcmp(arg,"--regression-threshold")){ options.regression_threshold = parse_uint(arg,value); ++i; }
+        else if(!strcmp(arg,"--log-level")){
+            if(!value) throw runtime_error("Missing value for --log-level");
+            options.log_level = value; ++i;
+        }
+        else throw runtime_error(string("Unknown argument: ")+arg);
+    }
+    if(!options.width || !options.height) throw runtime_error("Window size must be non-zero");
+    if(!options.threads) throw runtime_error("Thread count must be non-zero");
+    if(options.record_benchmark){
+        options.headless = true;
+        options.frames = 0;
+    }
+    //the frame count comes from the capture once it is loaded
+    if(options.replay_path){
+        options.headless = true;
+        options.frame_limit = true;
+    }
+    if(options.baseline_path && options.record_benchmark) throw runtime_error("--baseline needs frames to compare, not --record-benchmark");
+    return options;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <thread>
+#include "present_policy.hpp"
+
+//what the fragment shader writes, passed to it as a specialization constant, so the values are the shader's color_mode
+enum class color_mode : uint32_t{
+    modulate,
+    texture,
+    vertex
+};
+
+struct app_options{
+    bool headless = false;
+    //headless runs always stop after frames, windowed runs only when --frames is given, both then print the frame stats
+    unsigned int frames = 1000;
+    bool frame_limit = false;
+    unsigned int warmup_frames = 10;
+    unsigned int width = 500, height = 500;
+    //Chrome trace JSON, or CSV if the path ends in .csv, written on exit
+    const char *trace_path = nullptr;
+    //minimum debug messenger severity written to debug.txt: verbose, info, warning or error, defaults to $TRIANGLE_LOG_LEVEL
+    const char *log_level = "warning";
+    //enable the validation layer and debug messenger (validation builds only), defaults to $TRIANGLE_VALIDATION or on
+    bool validation = true;
+    //physical device name substring or deviceUUID to run on instead of the highest scoring one, defaults to $TRIANGLE_DEVICE
+    const char *device = nullptr;
+    //persisted VkPipelineCache blob, loaded at startup and rewritten on exit
+    const char *pipeline_cache_path = "pipeline-cache.bin";
+    //number of triangle objects in the scene and threads recording them
+    unsigned int draws = 1;
+    //--draw-path indirect: culled instanced vkCmdDrawIndexedIndirect, direct: one vkCmdDraw per visible object
+    bool indirect_draws = true;
+    //--async-compute on: run the particle pass on a separate compute family when there is one, off: serialize it on the graphics queue
+    bool async_compute = true;
+    //number of procedural material textures spread over the objects, and --bindless on: index them from one descriptor array
+    //with a push constant, off: bind one descriptor set per material (falls back to off without descriptor indexing)
+    unsigned int materials = 16;
+    bool bindless = true;
+    //--color-mode modulate: vertex color times the material texture, texture: the texture alone, vertex: no texture fetch
+    color_mode fragment_color_mode = color_mode::modulate;
+    unsigned int threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+    //frames the CPU may queue ahead of the GPU, and whether to drain that queue before sampling input (--pacing latency)
+    unsigned int frames_in_flight = 2;
+    bool low_latency = false;
+    //swapchain present mode and image count profile (--present-policy)
+    present_policy presentation_policy = present_policy::low_latency;
+    //headless only: time secondary command buffer recording across draw and thread counts, then exit
+    bool record_benchmark = false;
+    //--capture: write every frame's inputs and timings to this file on exit, --replay: run headless through a capture's frames
+    //with its settings instead of the command line's, --baseline: compare frame times against a capture and exit with 1 when
+    //the p50 CPU or GPU time is more than regression_threshold percent slower
+    const char *capture_path = nullptr, *replay_path = nullptr, *baseline_path = nullptr;
+    unsigned int regression_threshold = 10;
+};
+
+//parses the command line, throws runtime_error on unknown or malformed arguments
+app_options parse_options(int argc, char **argv);
+const char *color_mode_name(color_mode mode);
@@ -0,0 +1,80 @@
+#include "parallel_recorder.hpp"
+#include <stdexcept>
+using namespace std;
+
+parallel_recorder::parallel_recorder(VkDevice logical_device, unsigned int queue_family_index, worker_pool &workers, unsigned int slot_count, unsigned int draws_per_chunk) :
+    logical_device(logical_device), workers(workers), draws_per_chunk(draws_per_chunk ? draws_per_chunk : 1), pools(slot_count), recorded(slot_count) {
+    VkCommandPoolCreateInfo commandpool_info {};
+    commandpool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandpool_info.queueFamilyIndex = queue_family_index;
+    commandpool_info.pNext = nullptr;
+    commandpool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    for(vector<worker_slot> &slot : pools){
+        slot.resize(workers.size());
+        for(worker_slot &worker : slot){
+            worker.used = 0;
+            if(vkCreateCommandPool(logical_device,&commandpool_info,nullptr,&worker.commandpool)!=VK_SUCCESS) throw runtime_error("Error creating worker command pool");
+        }
+    }
+}
+
+VkCommandBuffer parallel_recorder::acquire(worker_slot &target){
+    if(target.used == target.commandbuffers.size()){
+        VkCommandBufferAllocateInfo allocate_info {};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.pNext = nullptr;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocate_info.commandPool = target.commandpool;
+        allocate_info.commandBufferCount = 1;
+
+        VkCommandBuffer commandbuffer;
+        if(vkAllocateCommandBuffers(logical_device,&allocate_info,&commandbuffer)!=VK_SUCCESS) throw runtime_error("Error allocating secondary command buffer");
+        target.commandbuffers.push_back(commandbuffer);
+    }
+    return target.commandbuffers[target.used++];
+}
+
+const vector<VkCommandBuffer> &parallel_recorder::record(unsigned int slot, const VkCommandBufferInheritanceInfo &inheritance, const function<void(VkCommandBuffer)> &bind_state, const vector<draw_item> &draws,
+    const function<void(VkCommandBuffer,unsigned int)> &bind_material){
+    vector<worker_slot> &slot_pools = pools[slot];
+    for(worker_slot &worker : slot_pools){
+        //buffers are kept allocated across resets, so steady state recording allocates nothing
+        if(vkResetCommandPool(logical_device,worker.commandpool,0)!=VK_SUCCESS) throw runtime_error("Error resetting worker command pool");
+        worker.used = 0;
+    }
+
+    unsigned int chunk_count = (draws.size()+draws_per_chunk-1)/draws_per_chunk;
+    vector<VkCommandBuffer> &secondaries = recorded[slot];
+    secondaries.resize(chunk_count);
+
+    workers.run(chunk_count,[&](unsigned int chunk, unsigned int worker){
+        VkCommandBuffer commandbuffer = acquire(slot_pools[worker]);
+
+        VkCommandBufferBeginInfo begin_info {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.pNext = nullptr;
+        begin_info.pInheritanceInfo = &inheritance;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        if(vkBeginCommandBuffer(commandbuffer,&begin_info)!=VK_SUCCESS) throw runtime_error("Error starting secondary command buffer recording state");
+
+        bind_state(commandbuffer);
+        size_t end = min(draws.size(),(size_t)(chunk+1)*draws_per_chunk);
+        for(size_t i = (size_t)chunk*draws_per_chunk; i < end; ++i){
+            if(bind_material && (i == (size_t)chunk*draws_per_chunk || draws[i].material != draws[i-1].material)) bind_material(commandbuffer,draws[i].material);
+            vkCmdDraw(commandbuffer,draws[i].vertex_count,draws[i].instance_count,draws[i].first_vertex,draws[i].first_instance);
+        }
+
+        if(vkEndCommandBuffer(commandbuffer)!=VK_SUCCESS) throw runtime_error("Error ending secondary command buffer recording state");
+        secondaries[chunk] = commandbuffer;
+    });
+    return secondaries;
+}
+
+void parallel_recorder::destroy(){
+    for(vector<worker_slot> &slot : pools){
+        for(worker_slot &worker : slot) vkDestroyCommandPool(logical_device,worker.commandpool,nullptr);
+    }
+    pools.clear();
+    recorded.clear();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "job_system.hpp"
+
+struct draw_item{
+    unsigned int vertex_count, instance_count, first_vertex, first_instance;
+    unsigned int material;
+};
+
+//records a draw list into secondary command buffers across a worker_pool, every worker owns one command pool per slot
+//because pools are externally synchronized, so workers never contend on a pool
+class parallel_recorder{
+public:
+    //slot_count is the number of independently recorded targets (e.g. one per framebuffer), each needs its own pools
+    //since a slot's buffers can only be reset once the GPU is done with them
+    parallel_recorder(VkDevice logical_device, unsigned int queue_family_index, worker_pool &workers, unsigned int slot_count, unsigned int draws_per_chunk = 256);
+
+    //resets slot's pools and records draws into secondaries inheriting inheritance's render pass, bind_state is called at the
+    //start of every secondary (secondaries inherit no pipeline state), bind_material (if set) before the first draw of a
+    //secondary and whenever the material changes, returns the secondaries in draw order for vkCmdExecuteCommands
+    const std::vector<VkCommandBuffer> &record(unsigned int slot, const VkCommandBufferInheritanceInfo &inheritance, const std::function<void(VkCommandBuffer)> &bind_state, const std::vector<draw_item> &draws,
+        const std::function<void(VkCommandBuffer,unsigned int)> &bind_material = nullptr);
+
+    void destroy();
+
+private:
+    struct worker_slot{
+        VkCommandPool commandpool;
+        std::vector<VkCommandBuffer> commandbuffers;
+        unsigned int used;
+    };
+
+    VkCommandBuffer acquire(worker_slot &target);
+
+    VkDevice logical_device;
+    worker_pool &workers;
+    unsigned int draws_per_chunk;
+    //indexed [slot][worker]
+    std::vector<std::vector<worker_slot>> pools;
+    std::vector<std::vector<VkCommandBuffer>> recorded;
+};
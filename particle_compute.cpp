@@ -0,0 +1,180 @@
+#include "particle_compute.hpp"
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+//particles.comp's local_size_x, a specialization constant so the dispatch below and the shader cannot disagree
+static const uint32_t group_size = 64;
+
+struct simulation_constants{
+    float time;
+    float drift;
+    uint32_t count;
+};
+
+particle_compute::particle_compute(VkDevice logical_device, gpu_allocator &allocator, const VkPhysicalDeviceProperties &device_properties, shader_cache &shaders, VkPipelineCache pipeline_cache,
+    descriptor_layout_cache &layouts, descriptor_allocator &sets,
+    queue_timeline *compute, unsigned int compute_family, unsigned int graphics_family, unsigned int object_count, float drift, unsigned int frames_in_flight)
+    : logical_device(logical_device), allocator(allocator), compute(compute), compute_family(compute_family), graphics_family(graphics_family), object_count(object_count), drift(drift) {
+    //each slot's region starts on a valid dynamic storage buffer offset
+    const VkDeviceSize alignment = max<VkDeviceSize>(device_properties.limits.minStorageBufferOffsetAlignment,8);
+    region_size = (max(object_count,1u)*2*sizeof(float)+alignment-1)/alignment*alignment;
+    offsets = allocator.create_buffer(region_size*frames_in_flight,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkDescriptorSetLayoutBinding binding {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    binding.pImmutableSamplers = nullptr;
+
+    set_layout = layouts.get({binding});
+
+    VkPushConstantRange push_constant_range {};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(simulation_constants);
+
+    VkPipelineLayoutCreateInfo layout_info {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.pNext = nullptr;
+    layout_info.flags = 0;
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_constant_range;
+    if(vkCreatePipelineLayout(logical_device,&layout_info,nullptr,&pipeline_layout)!=VK_SUCCESS) throw runtime_error("Error creating particle pipeline layout");
+
+    shader_variant variant;
+    variant.set(0,group_size);
+    VkSpecializationMapEntry specialization_entries[shader_variant::max_constants];
+    VkSpecializationInfo specialization = variant.info(specialization_entries);
+
+    VkComputePipelineCreateInfo pipeline_info {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.pNext = nullptr;
+    pipeline_info.flags = 0;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.pNext = nullptr;
+    pipeline_info.stage.flags = 0;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = shaders.load("shader-bin/particles.spv");
+    pipeline_info.stage.pName = "main";
+    pipeline_info.stage.pSpecializationInfo = &specialization;
+    pipeline_info.layout = pipeline_layout;
+    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+    pipeline_info.basePipelineIndex = -1;
+    if(vkCreateComputePipelines(logical_device,pipeline_cache,1,&pipeline_info,nullptr,&pipeline)!=VK_SUCCESS) throw runtime_error("Error creating particle pipeline");
+
+    descriptor_set = sets.allocate(set_layout);
+
+    VkDescriptorBufferInfo buffer_info {};
+    buffer_info.buffer = offsets.buffer;
+    buffer_info.offset = 0;
+    buffer_info.range = region_size;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = nullptr;
+    write.dstSet = descriptor_set;
+    write.dstBinding = 0;
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    write.pImageInfo = nullptr;
+    write.pBufferInfo = &buffer_info;
+    write.pTexelBufferView = nullptr;
+    vkUpdateDescriptorSets(logical_device,1,&write,0,nullptr);
+
+    if(!compute) return;
+
+    //one transient pool per frame slot on the compute family, reset when the slot comes around again
+    VkCommandPoolCreateInfo commandpool_info {};
+    commandpool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandpool_info.pNext = nullptr;
+    commandpool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandpool_info.queueFamilyIndex = compute_family;
+
+    VkCommandBufferAllocateInfo commandbuffer_info {};
+    commandbuffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandbuffer_info.pNext = nullptr;
+    commandbuffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandbuffer_info.commandBufferCount = 1;
+
+    commandpools.resize(frames_in_flight);
+    commandbuffers.resize(frames_in_flight);
+    for(unsigned int i = 0; i < frames_in_flight; ++i){
+        if(vkCreateCommandPool(logical_device,&commandpool_info,nullptr,&commandpools[i])!=VK_SUCCESS) throw runtime_error("Error creating compute command pool");
+        commandbuffer_info.commandPool = commandpools[i];
+        if(vkAllocateCommandBuffers(logical_device,&commandbuffer_info,&commandbuffers[i])!=VK_SUCCESS) throw runtime_error("Error allocating compute command buffer");
+    }
+}
+
+VkBufferMemoryBarrier particle_compute::slot_barrier(unsigned int slot) const{
+    VkBufferMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.srcQueueFamilyIndex = compute ? compute_family : VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = compute ? graphics_family : VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = offsets.buffer;
+    barrier.offset = slot_offset(slot);
+    barrier.size = region_size;
+    return barrier;
+}
+
+void particle_compute::cmd_dispatch(VkCommandBuffer commandbuffer, unsigned int slot, float time){
+    if(!object_count) return;
+    simulation_constants constants {time,drift,object_count};
+    uint32_t dynamic_offset = slot_offset(slot);
+    vkCmdBindPipeline(commandbuffer,VK_PIPELINE_BIND_POINT_COMPUTE,pipeline);
+    vkCmdBindDescriptorSets(commandbuffer,VK_PIPELINE_BIND_POINT_COMPUTE,pipeline_layout,0,1,&descriptor_set,1,&dynamic_offset);
+    vkCmdPushConstants(commandbuffer,pipeline_layout,VK_SHADER_STAGE_COMPUTE_BIT,0,sizeof(constants),&constants);
+    vkCmdDispatch(commandbuffer,(object_count+group_size-1)/group_size,1,1);
+}
+
+semaphore_wait particle_compute::submit(unsigned int slot, float time){
+    if(!compute) return {VK_NULL_HANDLE,0,0};
+
+    //the slot's previous dispatch was waited on by a graphics frame that has since completed, so its pool is free
+    if(vkResetCommandPool(logical_device,commandpools[slot],0)!=VK_SUCCESS) throw runtime_error("Error resetting compute command pool");
+
+    VkCommandBufferBeginInfo begin_info {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.pNext = nullptr;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    begin_info.pInheritanceInfo = nullptr;
+    if(vkBeginCommandBuffer(commandbuffers[slot],&begin_info)!=VK_SUCCESS) throw runtime_error("Error starting compute command buffer");
+
+    cmd_dispatch(commandbuffers[slot],slot,time);
+
+    //release half of the ownership transfer, the graphics family acquires the region in cmd_consume, nothing is handed back
+    //since the next dispatch overwrites the whole region without reading it
+    VkBufferMemoryBarrier release = slot_barrier(slot);
+    release.dstAccessMask = 0;
+    vkCmdPipelineBarrier(commandbuffers[slot],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,0,0,nullptr,1,&release,0,nullptr);
+
+    if(vkEndCommandBuffer(commandbuffers[slot])!=VK_SUCCESS) throw runtime_error("Error ending compute command buffer");
+    return {compute->handle(),compute->submit(commandbuffers[slot],{}),consume_stages};
+}
+
+void particle_compute::cmd_consume(VkCommandBuffer commandbuffer, unsigned int slot, float time){
+    VkBufferMemoryBarrier barrier = slot_barrier(slot);
+    if(compute){
+        //acquire half, the source stage is the stage the semaphore wait was issued at, so it is ordered after the release
+        barrier.srcAccessMask = 0;
+        vkCmdPipelineBarrier(commandbuffer,consume_stages,consume_stages,0,0,nullptr,1,&barrier,0,nullptr);
+    }else{
+        cmd_dispatch(commandbuffer,slot,time);
+        vkCmdPipelineBarrier(commandbuffer,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,consume_stages,0,0,nullptr,1,&barrier,0,nullptr);
+    }
+}
+
+void particle_compute::destroy(){
+    for(VkCommandPool commandpool : commandpools) vkDestroyCommandPool(logical_device,commandpool,nullptr);
+    commandpools.clear();
+    vkDestroyPipeline(logical_device,pipeline,nullptr);
+    vkDestroyPipelineLayout(logical_device,pipeline_layout,nullptr);
+    allocator.destroy_buffer(offsets);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "descriptors.hpp"
+#include "gpu_allocator.hpp"
+#include "shader_cache.hpp"
+#include "shader_variant.hpp"
+#include "timeline.hpp"
+
+//animates a vec2 offset per instance with shader-bin/particles.spv, one region of the offset buffer per frame slot, read by the
+//vertex shader as a dynamic storage buffer
+//with a compute timeline (a queue of a separate compute family) each slot's dispatch is submitted on its own command pool
+//there, ownership of the region is released to the graphics family and the graphics submit waits on the compute timeline,
+//so the simulation overlaps the previous frame's rendering, without one the dispatch is recorded into the graphics command
+//buffer ahead of the render pass and runs serialized with it
+//the set layout comes from the shared layout cache and the set from a long-lived allocator, both owned by the caller
+class particle_compute{
+public:
+    particle_compute(VkDevice logical_device, gpu_allocator &allocator, const VkPhysicalDeviceProperties &device_properties, shader_cache &shaders, VkPipelineCache pipeline_cache,
+        descriptor_layout_cache &layouts, descriptor_allocator &sets, queue_timeline *compute, unsigned int compute_family, unsigned int graphics_family, unsigned int object_count, float drift, unsigned int frames_in_flight);
+
+    bool async() const { return compute != nullptr; }
+    VkBuffer buffer() const { return offsets.buffer; }
+    VkDeviceSize slot_size() const { return region_size; }
+    uint32_t slot_offset(unsigned int slot) const { return slot*region_size; }
+
+    //async only: submits the slot's dispatch, call once the slot's last graphics frame has completed, returns what the
+    //graphics submit has to wait on, value 0 when serialized
+    semaphore_wait submit(unsigned int slot, float time);
+    //records the serialized dispatch or the acquire of the async one into the graphics command buffer, outside a render pass
+    void cmd_consume(VkCommandBuffer commandbuffer, unsigned int slot, float time);
+
+    void destroy();
+
+private:
+    void cmd_dispatch(VkCommandBuffer commandbuffer, unsigned int slot, float time);
+    VkBufferMemoryBarrier slot_barrier(unsigned int slot) const;
+
+    //where the draw first reads the offsets, both the graphics submit's wait on the compute timeline and the acquire barrier's
+    //source stage, so the acquire chains with the wait and the two can not drift apart
+    static constexpr VkPipelineStageFlags consume_stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+    VkDevice logical_device;
+    gpu_allocator &allocator;
+    queue_timeline *compute;
+    unsigned int compute_family, graphics_family, object_count;
+    float drift;
+
+    gpu_buffer offsets;
+    VkDeviceSize region_size;
+    VkDescriptorSetLayout set_layout;
+    VkPipelineLayout pipeline_layout;
+    VkPipeline pipeline;
+    VkDescriptorSet descriptor_set;
+    std::vector<VkCommandPool> commandpools;
+    std::vector<VkCommandBuffer> commandbuffers;
+};
@@ -0,0 +1,82 @@
+#include "pipeline_cache.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+using namespace std;
+
+static vector<unsigned char> read_file(const char *path){
+    vector<unsigned char> data;
+    FILE *file = fopen(path,"rb");
+    if(!file) return data;
+    fseek(file,0,SEEK_END);
+    long size = ftell(file);
+    fseek(file,0,SEEK_SET);
+    if(size > 0){
+        data.resize(size);
+        if(fread(data.data(),1,size,file) != (size_t)size) data.clear();
+    }
+    fclose(file);
+    return data;
+}
+
+pipeline_cache::pipeline_cache(VkDevice logical_device, const VkPhysicalDeviceProperties &device_properties, const char *path) : logical_device(logical_device), path(path) {
+    vector<unsigned char> data = read_file(path);
+    if(!data.empty() && !header_matches(data.data(),data.size(),device_properties)){
+        cerr << "Ignoring pipeline cache " << path << ", it was written by a different device or driver\n";
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo cache_info {};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.pNext = nullptr;
+    cache_info.flags = 0;
+    cache_info.initialDataSize = data.size();
+    cache_info.pInitialData = data.empty() ? nullptr : data.data();
+    if(vkCreatePipelineCache(logical_device,&cache_info,nullptr,&cache)!=VK_SUCCESS){
+        //drivers may still reject data whose header looked fine, start cold rather than fail
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = nullptr;
+        data.clear();
+        if(vkCreatePipelineCache(logical_device,&cache_info,nullptr,&cache)!=VK_SUCCESS) throw runtime_error("Error creating pipeline cache");
+    }
+    loaded = !data.empty();
+}
+
+bool pipeline_cache::header_matches(const unsigned char *data, size_t size, const VkPhysicalDeviceProperties &device_properties) const{
+    VkPipelineCacheHeaderVersionOne header;
+    if(size < sizeof(header)) return false;
+    memcpy(&header,data,sizeof(header));
+    return header.headerSize >= sizeof(header) && header.headerSize <= size
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == device_properties.vendorID
+        && header.deviceID == device_properties.deviceID
+        && !memcmp(header.pipelineCacheUUID,device_properties.pipelineCacheUUID,VK_UUID_SIZE);
+}
+
+void pipeline_cache::save() const{
+    size_t size;
+    if(vkGetPipelineCacheData(logical_device,cache,&size,nullptr)!=VK_SUCCESS || !size) return;
+    vector<unsigned char> data(size);
+    if(vkGetPipelineCacheData(logical_device,cache,&size,data.data())!=VK_SUCCESS) return;
+
+    string temporary_path = path+".tmp";
+    FILE *file = fopen(temporary_path.c_str(),"wb");
+    if(!file){
+        cerr << "Error writing pipeline cache " << temporary_path << '\n';
+        return;
+    }
+    bool written = fwrite(data.data(),1,size,file) == size && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    fclose(file);
+    if(!written || rename(temporary_path.c_str(),path.c_str())){
+        cerr << "Error writing pipeline cache " << path << '\n';
+        remove(temporary_path.c_str());
+    }
+}
+
+void pipeline_cache::destroy(){
+    if(cache != VK_NULL_HANDLE) vkDestroyPipelineCache(logical_device,cache,nullptr);
+    cache = VK_NULL_HANDLE;
+}
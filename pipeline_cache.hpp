@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vulkan/vulkan.h>
+
+//VkPipelineCache persisted between runs, the blob is only reused if its header matches this device and driver
+class pipeline_cache{
+public:
+    pipeline_cache(VkDevice logical_device, const VkPhysicalDeviceProperties &device_properties, const char *path);
+
+    VkPipelineCache handle() const { return cache; }
+    //true if valid data from a previous run was loaded
+    bool warm() const { return loaded; }
+
+    //writes the cache to a temporary file and renames it over path, so a crash never leaves a truncated blob behind
+    void save() const;
+    void destroy();
+
+private:
+    bool header_matches(const unsigned char *data, size_t size, const VkPhysicalDeviceProperties &device_properties) const;
+
+    VkDevice logical_device;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::string path;
+    bool loaded = false;
+};
@@ -0,0 +1,306 @@
+#include "pipeline_manager.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+bool pipeline_key::operator==(const pipeline_key &other) const{
+    if(renderpass != other.renderpass || subpass != other.subpass || layout != other.layout) return false;
+    if(vertex_shader != other.vertex_shader || fragment_shader != other.fragment_shader) return false;
+    if(!(vertex_variant == other.vertex_variant) || !(fragment_variant == other.fragment_variant)) return false;
+    if(vertex_stride != other.vertex_stride || attribute_count != other.attribute_count) return false;
+    for(uint32_t i = 0; i < attribute_count; ++i){
+        if(attribute_formats[i] != other.attribute_formats[i] || attribute_offsets[i] != other.attribute_offsets[i]) return false;
+    }
+    return topology == other.topology && polygon_mode == other.polygon_mode && cull_mode == other.cull_mode && front_face == other.front_face && blend == other.blend;
+}
+
+//FNV-1a over the key's fields, like the shader cache
+size_t pipeline_key_hash::operator()(const pipeline_key &key) const{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](uint64_t word){
+        hash ^= word;
+        hash *= 1099511628211ull;
+    };
+    mix((uint64_t)(uintptr_t)key.renderpass);
+    mix(key.subpass);
+    mix((uint64_t)(uintptr_t)key.layout);
+    mix((uint64_t)(uintptr_t)key.vertex_shader);
+    mix((uint64_t)(uintptr_t)key.fragment_shader);
+    hash = key.fragment_variant.hash(key.vertex_variant.hash(hash));
+    mix((uint64_t)key.vertex_stride<<32|key.attribute_count);
+    for(uint32_t i = 0; i < key.attribute_count; ++i) mix((uint64_t)key.attribute_formats[i]<<32|key.attribute_offsets[i]);
+    mix((uint64_t)key.topology<<32|key.polygon_mode);
+    mix((uint64_t)key.cull_mode<<32|key.front_face);
+    mix(key.blend);
+    return hash;
+}
+
+pipeline_manager::pipeline_manager(VkDevice logical_device, VkPipelineCache pipeline_cache) : logical_device(logical_device), pipeline_cache(pipeline_cache) {
+    compiler = thread(&pipeline_manager::run,this);
+}
+
+pipeline_manager::~pipeline_manager(){
+    destroy();
+}
+
+VkPipeline pipeline_manager::compile(const pipeline_key &key){
+    VkVertexInputBindingDescription vertex_binding {};
+    vertex_binding.binding = 0;
+    vertex_binding.stride = key.vertex_stride;
+    vertex_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription vertex_attributes[4] {};
+    for(uint32_t i = 0; i < key.attribute_count; ++i){
+        vertex_attributes[i].location = i;
+        vertex_attributes[i].binding = 0;
+        vertex_attributes[i].format = key.attribute_formats[i];
+        vertex_attributes[i].offset = key.attribute_offsets[i];
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertex_input {};
+    vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertex_input.pNext = nullptr;
+    vertex_input.flags = 0;
+    vertex_input.pVertexAttributeDescriptions = vertex_attributes;
+    vertex_input.pVertexBindingDescriptions = &vertex_binding;
+    vertex_input.vertexAttributeDescriptionCount = key.attribute_count;
+    vertex_input.vertexBindingDescriptionCount = 1;
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly {};
+    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.flags = 0;
+    input_assembly.pNext = nullptr;
+    input_assembly.primitiveRestartEnable = VK_FALSE;
+    input_assembly.topology = key.topology;
+
+    //viewport and scissor are dynamic, so a resize never rebuilds the pipeline
+    VkPipelineViewportStateCreateInfo viewport_state {};
+    viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+    viewport_state.pViewports = nullptr;
+    viewport_state.pScissors = nullptr;
+    viewport_state.pNext = nullptr;
+    viewport_state.flags = 0;
+
+    const VkDynamicState dynamic_states[2] = {VK_DYNAMIC_STATE_VIEWPORT,VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic_state {};
+    dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state.pNext = nullptr;
+    dynamic_state.flags = 0;
+    dynamic_state.dynamicStateCount = 2;
+    dynamic_state.pDynamicStates = dynamic_states;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = key.polygon_mode;
+    rasterizer.pNext = nullptr;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.frontFace = key.front_face;
+    rasterizer.flags = 0;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+    rasterizer.cullMode = key.cull_mode;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment {};
+    color_blend_attachment.blendEnable = key.blend;
+    color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_A_BIT|VK_COLOR_COMPONENT_B_BIT|VK_COLOR_COMPONENT_G_BIT|VK_COLOR_COMPONENT_R_BIT;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_state {};
+    color_blend_state.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_state.pNext = nullptr;
+    color_blend_state.pAttachments = &color_blend_attachment;
+    color_blend_state.logicOpEnable = VK_FALSE;
+    color_blend_state.flags = 0;
+    color_blend_state.attachmentCount = 1;
+
+    VkPipelineMultisampleStateCreateInfo multisample_info {};
+    multisample_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample_info.sampleShadingEnable = VK_FALSE;
+    multisample_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisample_info.pSampleMask = nullptr;
+    multisample_info.pNext = nullptr;
+    multisample_info.minSampleShading = 0;
+    multisample_info.flags = 0;
+    multisample_info.alphaToOneEnable = VK_FALSE;
+    multisample_info.alphaToCoverageEnable = VK_FALSE;
+
+    VkSpecializationMapEntry vs_entries[shader_variant::max_constants], fs_entries[shader_variant::max_constants];
+    VkSpecializationInfo vs_specialization = key.vertex_variant.info(vs_entries), fs_specialization = key.fragment_variant.info(fs_entries);
+
+    VkPipelineShaderStageCreateInfo shader_stages[2] {};
+    shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shader_stages[0].flags = 0;
+    shader_stages[0].module = key.vertex_shader;
+    shader_stages[0].pName = "main";
+    shader_stages[0].pNext = nullptr;
+    shader_stages[0].pSpecializationInfo = &vs_specialization;
+    shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shader_stages[1].flags = 0;
+    shader_stages[1].module = key.fragment_shader;
+    shader_stages[1].pName = "main";
+    shader_stages[1].pNext = nullptr;
+    shader_stages[1].pSpecializationInfo = &fs_specialization;
+    shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkGraphicsPipelineCreateInfo pipeline_info {};
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pMultisampleState = &multisample_info;
+    pipeline_info.pNext = nullptr;
+    pipeline_info.pRasterizationState = &rasterizer;
+    pipeline_info.pStages = shader_stages;
+    pipeline_info.pTessellationState = nullptr;
+    pipeline_info.pVertexInputState = &vertex_input;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.renderPass = key.renderpass;
+    pipeline_info.stageCount = 2;
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.subpass = key.subpass;
+    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+    pipeline_info.basePipelineIndex = -1;
+    pipeline_info.layout = key.layout;
+    pipeline_info.pColorBlendState = &color_blend_state;
+    pipeline_info.pDepthStencilState = nullptr;
+    pipeline_info.pDynamicState = &dynamic_state;
+
+    //the pipeline cache is internally synchronized, so this runs on either thread
+    VkPipeline pipeline;
+    if(vkCreateGraphicsPipelines(logical_device,pipeline_cache,1,&pipeline_info,nullptr,&pipeline)!=VK_SUCCESS) throw runtime_error("Error creating pipeline");
+    return pipeline;
+}
+
+void pipeline_manager::record_compile(uint64_t begin_ns, uint64_t end_ns, bool background){
+    double ms = (end_ns-begin_ns)/1e6;
+    ++counters.compiled;
+    if(background) ++counters.background_compiled;
+    counters.compile_ms += ms;
+    counters.max_compile_ms = max(counters.max_compile_ms,ms);
+}
+
+VkPipeline pipeline_manager::get(const pipeline_key &key){
+    unique_lock<mutex> lock(state_mutex);
+    //a variant queued or compiling elsewhere is waited for rather than compiled twice, looked up again after every wake
+    //since inserts can rehash the map
+    idle.wait(lock,[&]{
+        auto found = pipelines.find(key);
+        return found == pipelines.end() || found->second != VK_NULL_HANDLE || failure;
+    });
+    if(failure) rethrow_exception(failure);
+    auto found = pipelines.find(key);
+    if(found != pipelines.end()){
+        ++counters.hits;
+        return found->second;
+    }
+    ++counters.misses;
+    pipelines[key] = VK_NULL_HANDLE;
+    lock.unlock();
+
+    uint64_t begin_ns = frame_profiler::now_ns();
+    VkPipeline pipeline;
+    try{
+        pipeline = compile(key);
+    }catch(...){
+        //a get() of the same key waiting on the placeholder wakes, finds it gone and compiles (and fails) itself
+        lock.lock();
+        pipelines.erase(key);
+        idle.notify_all();
+        throw;
+    }
+    uint64_t end_ns = frame_profiler::now_ns();
+
+    lock.lock();
+    pipelines[key] = pipeline;
+    record_compile(begin_ns,end_ns,false);
+    idle.notify_all();
+    return pipeline;
+}
+
+VkPipeline pipeline_manager::request(const pipeline_key &key, VkPipeline fallback){
+    lock_guard<mutex> lock(state_mutex);
+    if(failure) rethrow_exception(failure);
+    auto found = pipelines.find(key);
+    if(found == pipelines.end()){
+        ++counters.misses;
+        pipelines[key] = VK_NULL_HANDLE;
+        queue.push_back(key);
+        wake.notify_one();
+    }else if(found->second != VK_NULL_HANDLE){
+        ++counters.hits;
+        return found->second;
+    }
+    ++counters.fallbacks;
+    return fallback;
+}
+
+void pipeline_manager::wait_idle(){
+    unique_lock<mutex> lock(state_mutex);
+    idle.wait(lock,[&]{ return (queue.empty() && !compiling) || failure; });
+    if(failure) rethrow_exception(failure);
+}
+
+void pipeline_manager::run(){
+    unique_lock<mutex> lock(state_mutex);
+    while(1){
+        wake.wait(lock,[&]{ return stopping || !queue.empty(); });
+        if(stopping) return;
+        pipeline_key key = queue.front();
+        queue.pop_front();
+        compiling = true;
+        lock.unlock();
+
+        uint64_t begin_ns = frame_profiler::now_ns();
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        exception_ptr error;
+        try{
+            pipeline = compile(key);
+        }catch(...){
+            error = current_exception();
+        }
+        uint64_t end_ns = frame_profiler::now_ns();
+
+        lock.lock();
+        compiling = false;
+        if(error){
+            //the next request() or wait_idle() on the render thread rethrows it
+            failure = error;
+            pipelines.erase(key);
+        }else{
+            pipelines[key] = pipeline;
+            record_compile(begin_ns,end_ns,true);
+        }
+        idle.notify_all();
+    }
+}
+
+pipeline_stats pipeline_manager::stats() const{
+    lock_guard<mutex> lock(state_mutex);
+    return counters;
+}
+
+void pipeline_manager::report(FILE *out) const{
+    pipeline_stats current = stats();
+    fprintf(out,"pipelines: %u compiled (%u in the background), %llu hits, %llu misses, %llu fallback requests, %.2f ms average compile, %.2f ms max\n",
+        current.compiled,current.background_compiled,(unsigned long long)current.hits,(unsigned long long)current.misses,(unsigned long long)current.fallbacks,
+        current.compiled ? current.compile_ms/current.compiled : 0.0,current.max_compile_ms);
+}
+
+void pipeline_manager::destroy(){
+    {
+        lock_guard<mutex> lock(state_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if(compiler.joinable()) compiler.join();
+    for(auto &entry : pipelines) if(entry.second != VK_NULL_HANDLE) vkDestroyPipeline(logical_device,entry.second,nullptr);
+    pipelines.clear();
+    queue.clear();
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+#include "shader_variant.hpp"
+
+//everything that varies between graphics pipelines, state that never does (dynamic viewport and scissor, one sample, no depth,
+//entry point main) is filled in by pipeline_manager, keys are zero-initialized with {} so unused attribute slots compare equal
+struct pipeline_key{
+    VkRenderPass renderpass;
+    uint32_t subpass;
+    VkPipelineLayout layout;
+    VkShaderModule vertex_shader, fragment_shader;
+    shader_variant vertex_variant, fragment_variant;
+    //one interleaved vertex binding
+    uint32_t vertex_stride, attribute_count;
+    VkFormat attribute_formats[4];
+    uint32_t attribute_offsets[4];
+    VkPrimitiveTopology topology;
+    VkPolygonMode polygon_mode;
+    VkCullModeFlags cull_mode;
+    VkFrontFace front_face;
+    //straight alpha blending instead of overwriting the attachment
+    VkBool32 blend;
+
+    bool operator==(const pipeline_key &other) const;
+};
+
+struct pipeline_key_hash{
+    size_t operator()(const pipeline_key &key) const;
+};
+
+struct pipeline_stats{
+    //request() and get() calls finding a ready pipeline, calls that had to compile or queue one, request() calls answered with the fallback
+    uint64_t hits = 0, misses = 0, fallbacks = 0;
+    unsigned int compiled = 0, background_compiled = 0;
+    double compile_ms = 0, max_compile_ms = 0;
+};
+
+//deduplicates graphics pipelines by key, get() compiles a missing one on the calling thread, request() never blocks: a missing
+//variant is queued for the background thread and the caller draws with its fallback until the variant is ready, so a new
+//material shows up a few frames late rather than stalling one, all pipelines go through the shared VkPipelineCache
+class pipeline_manager{
+public:
+    pipeline_manager(VkDevice logical_device, VkPipelineCache pipeline_cache);
+    ~pipeline_manager();
+    pipeline_manager(const pipeline_manager&) = delete;
+    pipeline_manager &operator=(const pipeline_manager&) = delete;
+
+    VkPipeline get(const pipeline_key &key);
+    //rethrows a background compile failure
+    VkPipeline request(const pipeline_key &key, VkPipeline fallback);
+    //returns once every queued variant has been compiled
+    void wait_idle();
+
+    pipeline_stats stats() const;
+    void report(FILE *out) const;
+
+    //stops the background thread and destroys every pipeline
+    void destroy();
+
+private:
+    VkPipeline compile(const pipeline_key &key);
+    void record_compile(uint64_t begin_ns, uint64_t end_ns, bool background);
+    void run();
+
+    VkDevice logical_device;
+    VkPipelineCache pipeline_cache;
+    mutable std::mutex state_mutex;
+    std::condition_variable wake, idle;
+    //VK_NULL_HANDLE while a variant is queued or compiling
+    std::unordered_map<pipeline_key,VkPipeline,pipeline_key_hash> pipelines;
+    std::deque<pipeline_key> queue;
+    bool compiling = false, stopping = false;
+    std::exception_ptr failure;
+    pipeline_stats counters;
+    std::thread compiler;
+};
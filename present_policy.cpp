@@ -0,0 +1,78 @@
+#include "present_policy.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+present_policy parse_present_policy(const char *name){
+    if(!strcmp(name,"low-latency")) return present_policy::low_latency;
+    if(!strcmp(name,"power-saving")) return present_policy::power_saving;
+    if(!strcmp(name,"throughput")) return present_policy::throughput;
+    throw runtime_error(string("Invalid value for --present-policy: ")+name);
+}
+
+const char *present_policy_name(present_policy policy){
+    switch(policy){
+        case present_policy::low_latency: return "low-latency";
+        case present_policy::power_saving: return "power-saving";
+        case present_policy::throughput: return "throughput";
+    }
+    return "unknown";
+}
+
+const char *present_mode_name(VkPresentModeKHR present_mode){
+    switch(present_mode){
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+        default: return "other";
+    }
+}
+
+present_policy next_present_policy(present_policy policy){
+    switch(policy){
+        case present_policy::low_latency: return present_policy::power_saving;
+        case present_policy::power_saving: return present_policy::throughput;
+        default: return present_policy::low_latency;
+    }
+}
+
+presentation choose_presentation(present_policy policy, const VkPresentModeKHR *present_modes, unsigned int present_mode_count){
+    static const VkPresentModeKHR low_latency_order[] = {VK_PRESENT_MODE_MAILBOX_KHR,VK_PRESENT_MODE_IMMEDIATE_KHR,VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+    static const VkPresentModeKHR throughput_order[] = {VK_PRESENT_MODE_MAILBOX_KHR,VK_PRESENT_MODE_IMMEDIATE_KHR};
+
+    presentation chosen {VK_PRESENT_MODE_FIFO_KHR,policy == present_policy::throughput ? 1u : 0u};
+    const VkPresentModeKHR *order = nullptr;
+    unsigned int order_count = 0;
+    if(policy == present_policy::low_latency){
+        order = low_latency_order;
+        order_count = sizeof(low_latency_order)/sizeof(low_latency_order[0]);
+    }else if(policy == present_policy::throughput){
+        order = throughput_order;
+        order_count = sizeof(throughput_order)/sizeof(throughput_order[0]);
+    }
+    //FIFO is required of every surface, so it is the fallback whenever nothing better is offered
+    for(unsigned int i = 0; i < order_count; ++i){
+        for(unsigned int j = 0; j < present_mode_count; ++j){
+            if(present_modes[j] == order[i]){
+                chosen.present_mode = order[i];
+                return chosen;
+            }
+        }
+    }
+    return chosen;
+}
+
+VkSurfaceFormatKHR choose_surface_format(const VkSurfaceFormatKHR *surface_formats, unsigned int surface_format_count){
+    static const VkFormat srgb_formats[] = {VK_FORMAT_B8G8R8A8_SRGB,VK_FORMAT_R8G8B8A8_SRGB,VK_FORMAT_A8B8G8R8_SRGB_PACK32};
+
+    //a lone VK_FORMAT_UNDEFINED means the surface takes any format
+    if(surface_format_count == 1 && surface_formats[0].format == VK_FORMAT_UNDEFINED) return {VK_FORMAT_B8G8R8A8_SRGB,VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+    for(VkFormat format : srgb_formats){
+        for(unsigned int i = 0; i < surface_format_count; ++i){
+            if(surface_formats[i].format == format && surface_formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) return surface_formats[i];
+        }
+    }
+    return surface_formats[0];
+}
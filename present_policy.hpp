@@ -0,0 +1,28 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+//what the swapchain is tuned for, selectable with --present-policy and cycled at runtime with the P key
+//low_latency: the first of MAILBOX, IMMEDIATE, FIFO_RELAXED, FIFO with the surface minimum image count
+//power_saving: FIFO, vsynced and the only mode every surface supports, with the surface minimum image count
+//throughput: MAILBOX, then IMMEDIATE, then FIFO, with one image over the minimum so rendering never waits for a free image
+enum class present_policy{
+    low_latency,
+    power_saving,
+    throughput
+};
+
+struct presentation{
+    VkPresentModeKHR present_mode;
+    //swapchain images requested on top of the surface minimum
+    unsigned int extra_images;
+};
+
+//throws runtime_error on anything but low-latency, power-saving or throughput
+present_policy parse_present_policy(const char *name);
+const char *present_policy_name(present_policy policy);
+const char *present_mode_name(VkPresentModeKHR present_mode);
+present_policy next_present_policy(present_policy policy);
+
+presentation choose_presentation(present_policy policy, const VkPresentModeKHR *present_modes, unsigned int present_mode_count);
+//prefers an 8 bit sRGB format in the sRGB colour space so output is gamma correct, falls back to the first format offered
+VkSurfaceFormatKHR choose_surface_format(const VkSurfaceFormatKHR *surface_formats, unsigned int surface_format_count);
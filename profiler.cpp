@@ -0,0 +1,112 @@
+#include "profiler.hpp"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+timing_ring::timing_ring(size_t capacity) : slots(capacity) {
+    if(!capacity) throw runtime_error("Timing ring capacity must be non-zero");
+}
+
+void timing_ring::push(const timing_event &event){
+    uint64_t index = write_index.fetch_add(1,memory_order_relaxed);
+    slot &target = slots[index%slots.size()];
+    //sequence 0 marks the slot as being written so a concurrent snapshot skips it
+    target.sequence.store(0,memory_order_relaxed);
+    target.event = event;
+    target.sequence.store(index+1,memory_order_release);
+}
+
+vector<timing_event> timing_ring::snapshot() const{
+    uint64_t end = write_index.load(memory_order_acquire);
+    uint64_t begin = end > slots.size() ? end-slots.size() : 0;
+    vector<timing_event> result;
+    result.reserve(end-begin);
+    for(uint64_t i = begin; i < end; ++i){
+        const slot &source = slots[i%slots.size()];
+        if(source.sequence.load(memory_order_acquire) == i+1) result.push_back(source.event);
+    }
+    return result;
+}
+
+frame_profiler::frame_profiler(VkDevice logical_device, const VkPhysicalDeviceProperties &device_properties, const VkQueueFamilyProperties &queue_family, unsigned int slot_count, size_t event_capacity) :
+    logical_device(logical_device), timestamp_period(device_properties.limits.timestampPeriod), events(event_capacity) {
+    timestamp_mask = queue_family.timestampValidBits >= 64 ? ~0ull : (1ull<<queue_family.timestampValidBits)-1;
+    if(!queue_family.timestampValidBits) return;
+
+    VkQueryPoolCreateInfo query_pool_info {};
+    query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_info.pNext = nullptr;
+    query_pool_info.flags = 0;
+    query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_info.queryCount = 2*slot_count;
+    query_pool_info.pipelineStatistics = 0;
+    if(vkCreateQueryPool(logical_device,&query_pool_info,nullptr,&query_pool)!=VK_SUCCESS) throw runtime_error("Error creating query pool");
+}
+
+void frame_profiler::destroy(){
+    if(query_pool != VK_NULL_HANDLE) vkDestroyQueryPool(logical_device,query_pool,nullptr);
+    query_pool = VK_NULL_HANDLE;
+}
+
+void frame_profiler::cmd_begin(VkCommandBuffer commandbuffer, unsigned int slot){
+    if(query_pool == VK_NULL_HANDLE) return;
+    vkCmdResetQueryPool(commandbuffer,query_pool,2*slot,2);
+    vkCmdWriteTimestamp(commandbuffer,VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,query_pool,2*slot);
+}
+
+void frame_profiler::cmd_end(VkCommandBuffer commandbuffer, unsigned int slot){
+    if(query_pool == VK_NULL_HANDLE) return;
+    vkCmdWriteTimestamp(commandbuffer,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,query_pool,2*slot+1);
+}
+
+double frame_profiler::collect_gpu(unsigned int slot, uint32_t frame, uint64_t submit_ns, uint64_t *end_ns){
+    if(query_pool == VK_NULL_HANDLE) return -1;
+    uint64_t timestamps[2];
+    if(vkGetQueryPoolResults(logical_device,query_pool,2*slot,2,sizeof(timestamps),timestamps,sizeof(uint64_t),VK_QUERY_RESULT_64_BIT)!=VK_SUCCESS) return -1;
+
+    uint64_t begin_ticks = timestamps[0]&timestamp_mask, duration_ticks = (timestamps[1]-timestamps[0])&timestamp_mask;
+    if(!gpu_calibrated){
+        gpu_base_ticks = begin_ticks;
+        cpu_base_ns = submit_ns;
+        gpu_calibrated = true;
+    }
+    uint64_t begin_ns = cpu_base_ns+(uint64_t)(((begin_ticks-gpu_base_ticks)&timestamp_mask)*timestamp_period);
+    uint64_t duration_ns = duration_ticks*timestamp_period;
+    events.push({"renderpass",frame,TRACK_GPU,begin_ns,begin_ns+duration_ns});
+    if(end_ns) *end_ns = begin_ns+duration_ns;
+    return duration_ns/1e6;
+}
+
+void frame_profiler::record_cpu(const char *name, uint32_t frame, uint64_t begin_ns, uint64_t end_ns){
+    events.push({name,frame,TRACK_CPU,begin_ns,end_ns});
+}
+
+uint64_t frame_profiler::now_ns(){
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void frame_profiler::dump(const char *path) const{
+    FILE *file = fopen(path,"w");
+    if(!file) throw runtime_error(string("Error opening trace file ")+path);
+    vector<timing_event> snapshot = events.snapshot();
+    uint64_t origin = ~0ull;
+    for(const timing_event &event : snapshot) origin = min(origin,event.begin_ns);
+
+    size_t length = strlen(path);
+    if(length >= 4 && !strcmp(path+length-4,".csv")){
+        fprintf(file,"track,name,frame,begin_us,duration_us\n");
+        for(const timing_event &event : snapshot){
+            fprintf(file,"%s,%s,%u,%.3f,%.3f\n",event.track == TRACK_GPU ? "gpu" : "cpu",event.name,event.frame,(event.begin_ns-origin)/1e3,(event.end_ns-event.begin_ns)/1e3);
+        }
+    }else{
+        fprintf(file,"{\"traceEvents\":[\n");
+        fprintf(file,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"CPU\"}},\n",TRACK_CPU);
+        fprintf(file,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}",TRACK_GPU);
+        for(const timing_event &event : snapshot){
+            fprintf(file,",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",event.name,event.track,(event.begin_ns-origin)/1e3,(event.end_ns-event.begin_ns)/1e3,event.frame);
+        }
+        fprintf(file,"\n]}\n");
+    }
+    fclose(file);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+enum timing_track : uint32_t{
+    TRACK_CPU = 0,
+    TRACK_GPU = 1
+};
+
+//name must point to storage that outlives the profiler (string literals), events are copied by value into the ring
+struct timing_event{
+    const char *name;
+    uint32_t frame;
+    timing_track track;
+    uint64_t begin_ns, end_ns;
+};
+
+//fixed capacity ring of timing events, writers never block or allocate and the oldest events get overwritten once full
+class timing_ring{
+public:
+    explicit timing_ring(size_t capacity);
+
+    void push(const timing_event &event);
+    //copies out the retained events in submission order, only call once writers have stopped
+    std::vector<timing_event> snapshot() const;
+
+private:
+    struct slot{
+        std::atomic<uint64_t> sequence {0};
+        timing_event event;
+    };
+    std::vector<slot> slots;
+    std::atomic<uint64_t> write_index {0};
+};
+
+//records CPU scopes around the frame loop's Vulkan calls and GPU timestamps around each command buffer's render pass
+class frame_profiler{
+public:
+    //slot_count is the number of command buffers that bracket their work with cmd_begin/cmd_end
+    frame_profiler(VkDevice logical_device, const VkPhysicalDeviceProperties &device_properties, const VkQueueFamilyProperties &queue_family, unsigned int slot_count, size_t event_capacity = 1<<16);
+    //releases the query pool, call before the device is destroyed
+    void destroy();
+
+    bool gpu_supported() const { return query_pool != VK_NULL_HANDLE; }
+
+    void cmd_begin(VkCommandBuffer commandbuffer, unsigned int slot);
+    void cmd_end(VkCommandBuffer commandbuffer, unsigned int slot);
+
+    //call once the submission that used slot has retired, returns the render pass GPU time in milliseconds or a negative value if unavailable,
+    //end_ns receives when the render pass finished on the now_ns() clock
+    double collect_gpu(unsigned int slot, uint32_t frame, uint64_t submit_ns, uint64_t *end_ns = nullptr);
+
+    void record_cpu(const char *name, uint32_t frame, uint64_t begin_ns, uint64_t end_ns);
+    static uint64_t now_ns();
+
+    //writes Chrome trace JSON (chrome://tracing, Perfetto), or CSV when path ends in .csv
+    void dump(const char *path) const;
+
+    class scope{
+    public:
+        scope(frame_profiler &profiler, const char *name, uint32_t frame) : profiler(profiler), name(name), frame(frame), begin_ns(now_ns()) {}
+        ~scope(){ profiler.record_cpu(name,frame,begin_ns,now_ns()); }
+    private:
+        frame_profiler &profiler;
+        const char *name;
+        uint32_t frame;
+        uint64_t begin_ns;
+    };
+
+private:
+    VkDevice logical_device;
+    VkQueryPool query_pool = VK_NULL_HANDLE;
+    double timestamp_period;
+    uint64_t timestamp_mask;
+    //GPU ticks are mapped onto the CPU clock by pinning the first collected timestamp to its submission time
+    bool gpu_calibrated = false;
+    uint64_t gpu_base_ticks = 0, cpu_base_ns = 0;
+    timing_ring events;
+};
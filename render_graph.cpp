@@ -0,0 +1,699 @@
+#include "render_graph.hpp"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+using namespace std;
+
+static const VkAccessFlags write_access_mask = VK_ACCESS_SHADER_WRITE_BIT|VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT|VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|
+    VK_ACCESS_TRANSFER_WRITE_BIT|VK_ACCESS_HOST_WRITE_BIT|VK_ACCESS_MEMORY_WRITE_BIT;
+
+static bool is_depth_format(VkFormat format){
+    switch(format){
+    case VK_FORMAT_D16_UNORM: case VK_FORMAT_X8_D24_UNORM_PACK32: case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_D16_UNORM_S8_UINT: case VK_FORMAT_D24_UNORM_S8_UINT: case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+render_graph::render_graph(VkDevice logical_device, gpu_allocator &allocator) : logical_device(logical_device), allocator(allocator) {}
+
+uint32_t render_graph::add_resource(const char *name, resource_kind kind, VkFormat format, VkImageLayout final_layout){
+    if(!groups.empty()) throw runtime_error("Render graph is already compiled");
+    resource added {};
+    added.name = name;
+    added.kind = kind;
+    added.format = format;
+    added.final_layout = final_layout;
+    added.exported = kind == resource_kind::imported_image;
+    added.view = VK_NULL_HANDLE;
+    added.image = VK_NULL_HANDLE;
+    added.alias = UINT_MAX;
+    added.first_group = 0;
+    added.last_group = 0;
+    resources.push_back(move(added));
+    return resources.size()-1;
+}
+
+uint32_t render_graph::import_image(const char *name, VkFormat format, VkImageLayout final_layout){
+    return add_resource(name,resource_kind::imported_image,format,final_layout);
+}
+
+uint32_t render_graph::create_transient(const char *name, VkFormat format){
+    return add_resource(name,resource_kind::transient_image,format,VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+uint32_t render_graph::import_buffer(const char *name){
+    return add_resource(name,resource_kind::buffer,VK_FORMAT_UNDEFINED,VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+void render_graph::export_resource(uint32_t resource){
+    resources[resource].exported = true;
+}
+
+uint32_t render_graph::add_pass(const char *name, bool raster, VkSubpassContents contents, const function<void(VkCommandBuffer)> &execute){
+    if(!groups.empty()) throw runtime_error("Render graph is already compiled");
+    pass added {};
+    added.name = name;
+    added.raster = raster;
+    added.contents = contents;
+    added.execute = execute;
+    added.kept = false;
+    added.group = 0;
+    added.subpass = 0;
+    passes.push_back(move(added));
+    return passes.size()-1;
+}
+
+uint32_t render_graph::add_raster_pass(const char *name, VkSubpassContents contents, const function<void(VkCommandBuffer)> &execute){
+    return add_pass(name,true,contents,execute);
+}
+
+uint32_t render_graph::add_compute_pass(const char *name, const function<void(VkCommandBuffer)> &execute){
+    return add_pass(name,false,VK_SUBPASS_CONTENTS_INLINE,execute);
+}
+
+void render_graph::add_use(uint32_t pass, const use &added){
+    if(!groups.empty()) throw runtime_error("Render graph is already compiled");
+    render_graph::pass &user = passes[pass];
+    const resource &used = resources[added.resource];
+    bool attachment = added.kind == use_kind::color || added.kind == use_kind::depth || added.kind == use_kind::input;
+    if((added.kind == use_kind::buffer) != (used.kind == resource_kind::buffer)) throw runtime_error("Render graph resource "+used.name+" used as the wrong kind in pass "+user.name);
+    if(attachment && !user.raster) throw runtime_error("Compute pass "+user.name+" cannot use attachments");
+    for(const use &existing : user.uses){
+        if(existing.resource == added.resource) throw runtime_error("Pass "+user.name+" uses "+used.name+" twice");
+        if(existing.kind == use_kind::depth && added.kind == use_kind::depth) throw runtime_error("Pass "+user.name+" writes two depth attachments");
+    }
+    user.uses.push_back(added);
+}
+
+void render_graph::write_color(uint32_t pass, uint32_t image, const VkClearColorValue *clear){
+    use added {};
+    added.resource = image;
+    added.kind = use_kind::color;
+    added.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    //loading the previous contents is a color attachment read
+    added.access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT|(clear ? 0 : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+    added.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    added.reads = !clear;
+    added.writes = true;
+    added.discards = clear != nullptr;
+    if(clear) added.clear_value.color = *clear;
+    add_use(pass,added);
+}
+
+void render_graph::write_depth(uint32_t pass, uint32_t image, const VkClearDepthStencilValue *clear){
+    use added {};
+    added.resource = image;
+    added.kind = use_kind::depth;
+    added.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT|VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    added.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT|VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    added.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    added.reads = !clear;
+    added.writes = true;
+    added.discards = clear != nullptr;
+    if(clear) added.clear_value.depthStencil = *clear;
+    add_use(pass,added);
+}
+
+void render_graph::read_input(uint32_t pass, uint32_t image){
+    use added {};
+    added.resource = image;
+    added.kind = use_kind::input;
+    added.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    added.access = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    added.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    added.reads = true;
+    added.writes = false;
+    added.discards = false;
+    add_use(pass,added);
+}
+
+void render_graph::read_sampled(uint32_t pass, uint32_t image, VkPipelineStageFlags stages){
+    use added {};
+    added.resource = image;
+    added.kind = use_kind::sampled;
+    added.stages = stages;
+    added.access = VK_ACCESS_SHADER_READ_BIT;
+    added.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    added.reads = true;
+    added.writes = false;
+    added.discards = false;
+    add_use(pass,added);
+}
+
+void render_graph::read_buffer(uint32_t pass, uint32_t buffer, VkPipelineStageFlags stages, VkAccessFlags access){
+    use added {};
+    added.resource = buffer;
+    added.kind = use_kind::buffer;
+    added.stages = stages;
+    added.access = access;
+    added.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    added.reads = true;
+    added.writes = false;
+    added.discards = false;
+    add_use(pass,added);
+}
+
+void render_graph::write_buffer(uint32_t pass, uint32_t buffer, VkPipelineStageFlags stages, VkAccessFlags access){
+    use added {};
+    added.resource = buffer;
+    added.kind = use_kind::buffer;
+    added.stages = stages;
+    added.access = access;
+    added.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    //a buffer write may cover only part of it, so it never discards what came before
+    added.reads = (access & ~write_access_mask) != 0;
+    added.writes = true;
+    added.discards = false;
+    add_use(pass,added);
+}
+
+void render_graph::compile(){
+    if(!groups.empty()) throw runtime_error("Render graph is already compiled");
+
+    //culling, backwards from the exported resources: a pass is kept when it writes something still needed, what it reads is
+    //needed from then on, and a pass overwriting all of a resource satisfies every later reader
+    vector<bool> needed(resources.size());
+    for(unsigned int i = 0; i < resources.size(); ++i) needed[i] = resources[i].exported;
+    for(size_t i = passes.size(); i-- > 0;){
+        pass &current = passes[i];
+        for(const use &u : current.uses) if(u.writes && needed[u.resource]) current.kept = true;
+        if(!current.kept) continue;
+        for(const use &u : current.uses) if(u.discards) needed[u.resource] = false;
+        for(const use &u : current.uses) if(u.reads) needed[u.resource] = true;
+    }
+    //imported buffers may well be written before the frame, images never are
+    for(unsigned int i = 0; i < resources.size(); ++i){
+        if(needed[i] && resources[i].kind != resource_kind::buffer) throw runtime_error("Render graph reads "+resources[i].name+" before any pass writes it");
+    }
+
+    for(uint32_t i = 0; i < passes.size(); ++i){
+        pass &current = passes[i];
+        if(!current.kept) continue;
+        if(current.raster && !groups.empty() && groups.back().raster && can_merge(groups.back(),current)){
+            current.subpass = groups.back().passes.size();
+        }else{
+            pass_group added {};
+            added.raster = current.raster;
+            added.renderpass = VK_NULL_HANDLE;
+            groups.push_back(move(added));
+            current.subpass = 0;
+        }
+        current.group = groups.size()-1;
+        groups.back().passes.push_back(i);
+    }
+
+    timelines.assign(resources.size(),{});
+    for(const pass_group &group : groups){
+        for(uint32_t p : group.passes){
+            for(uint32_t u = 0; u < passes[p].uses.size(); ++u) timelines[passes[p].uses[u].resource].push_back({p,u});
+        }
+    }
+    for(unsigned int i = 0; i < resources.size(); ++i){
+        if(timelines[i].empty()) continue;
+        resources[i].first_group = passes[timelines[i].front().first].group;
+        resources[i].last_group = passes[timelines[i].back().first].group;
+    }
+
+    assign_alias_slots();
+    add_buffer_barriers();
+    vector<VkImageLayout> current_layouts(resources.size(),VK_IMAGE_LAYOUT_UNDEFINED);
+    for(pass_group &group : groups) if(group.raster) build_render_pass(group,current_layouts);
+}
+
+bool render_graph::can_merge(const pass_group &group, const pass &next) const{
+    for(uint32_t p : group.passes){
+        for(const use &earlier : passes[p].uses){
+            for(const use &later : next.uses){
+                if(earlier.resource != later.resource) continue;
+                //sampling an image written in the group needs its render pass to have ended, and so does writing one sampled in it
+                if(later.kind == use_kind::sampled && earlier.writes) return false;
+                if(earlier.kind == use_kind::sampled && later.writes) return false;
+                //buffer hazards need a pipeline barrier, which a render pass only allows as a self-dependency
+                if(later.kind == use_kind::buffer && (earlier.writes || later.writes)) return false;
+                //attachments are only cleared by the load op at the start of a render pass, a later clear needs a new one
+                if(later.discards) return false;
+            }
+        }
+    }
+    return true;
+}
+
+void render_graph::assign_alias_slots(){
+    //greedy interval assignment in order of first use: a transient reuses the first slot whose last occupant is done
+    //before it starts, the slot remembers every stage touching it so the next occupant's render pass waits on all of them
+    vector<uint32_t> transients;
+    for(uint32_t i = 0; i < resources.size(); ++i){
+        if(resources[i].kind == resource_kind::transient_image && !timelines[i].empty()) transients.push_back(i);
+    }
+    stable_sort(transients.begin(),transients.end(),[&](uint32_t a, uint32_t b){ return resources[a].first_group < resources[b].first_group; });
+
+    alias_slots.clear();
+    for(uint32_t r : transients){
+        resource &transient = resources[r];
+        transient.alias = alias_slots.size();
+        for(unsigned int i = 0; i < alias_slots.size(); ++i){
+            if(alias_slots[i].last_group < transient.first_group){
+                transient.alias = i;
+                break;
+            }
+        }
+        if(transient.alias == alias_slots.size()) alias_slots.push_back({0,0,0});
+        alias_slot &slot = alias_slots[transient.alias];
+        slot.last_group = transient.last_group;
+        for(const auto &entry : timelines[r]){
+            slot.stages |= use_at(entry).stages;
+            slot.write_access |= use_at(entry).access & write_access_mask;
+        }
+    }
+}
+
+void render_graph::add_buffer_barriers(){
+    //per buffer: the stages and accesses of the last write, the reads since, and what the last write was made visible to
+    struct buffer_state{
+        VkPipelineStageFlags write_stages, read_stages, visible_stages;
+        VkAccessFlags write_access, visible_access;
+    };
+    vector<buffer_state> states(resources.size(),buffer_state{0,0,0,0,0});
+
+    barrier_count = 0;
+    for(pass_group &group : groups){
+        group.src_stages = group.dst_stages = 0;
+        group.src_access = group.dst_access = 0;
+        for(uint32_t p : group.passes){
+            for(const use &u : passes[p].uses){
+                if(u.kind != use_kind::buffer) continue;
+                buffer_state &state = states[u.resource];
+                //read or write after write, skipped when an earlier barrier already made the write visible here
+                if(state.write_stages && ((u.stages & ~state.visible_stages) || (u.access & ~state.visible_access))){
+                    group.src_stages |= state.write_stages;
+                    group.src_access |= state.write_access;
+                    group.dst_stages |= u.stages;
+                    group.dst_access |= u.access;
+                    state.visible_stages |= u.stages;
+                    state.visible_access |= u.access;
+                }
+                //write after read only needs the reads to have executed
+                if(u.writes && state.read_stages){
+                    group.src_stages |= state.read_stages;
+                    group.dst_stages |= u.stages;
+                }
+                if(u.writes) state = {u.stages,0,0,u.access & write_access_mask,0};
+                else state.read_stages |= u.stages;
+            }
+        }
+        if(group.src_stages) ++barrier_count;
+    }
+}
+
+render_graph::render_pass_description render_graph::describe_render_pass(pass_group &group, vector<VkImageLayout> &current_layouts){
+    unsigned int group_index = &group-groups.data();
+    for(uint32_t p : group.passes){
+        for(const use &u : passes[p].uses){
+            if(u.kind != use_kind::color && u.kind != use_kind::depth && u.kind != use_kind::input) continue;
+            if(find(group.attachments.begin(),group.attachments.end(),u.resource) == group.attachments.end()) group.attachments.push_back(u.resource);
+        }
+    }
+
+    render_pass_description result;
+    vector<VkSubpassDependency> &dependencies = result.dependencies;
+    //one dependency per subpass pair with the masks merged, framebuffer-local between subpasses
+    auto depend = [&](uint32_t src, uint32_t dst, VkPipelineStageFlags src_stages, VkAccessFlags src_access, VkPipelineStageFlags dst_stages, VkAccessFlags dst_access){
+        for(VkSubpassDependency &dependency : dependencies){
+            if(dependency.srcSubpass != src || dependency.dstSubpass != dst) continue;
+            dependency.srcStageMask |= src_stages;
+            dependency.srcAccessMask |= src_access;
+            dependency.dstStageMask |= dst_stages;
+            dependency.dstAccessMask |= dst_access;
+            return;
+        }
+        VkSubpassDependency dependency {};
+        dependency.srcSubpass = src;
+        dependency.dstSubpass = dst;
+        dependency.srcStageMask = src_stages;
+        dependency.srcAccessMask = src_access;
+        dependency.dstStageMask = dst_stages;
+        dependency.dstAccessMask = dst_access;
+        dependency.dependencyFlags = src != VK_SUBPASS_EXTERNAL && dst != VK_SUBPASS_EXTERNAL ? VK_DEPENDENCY_BY_REGION_BIT : 0;
+        dependencies.push_back(dependency);
+    };
+
+    unsigned int subpass_count = group.passes.size();
+    vector<VkAttachmentDescription> &attachments = result.attachments;
+    attachments.resize(group.attachments.size());
+    group.clear_values.assign(group.attachments.size(),VkClearValue{});
+    //first and last subpass using each attachment as one, for preserve attachments
+    vector<unsigned int> first_subpass(group.attachments.size(),UINT_MAX), last_subpass(group.attachments.size(),0);
+
+    for(unsigned int a = 0; a < group.attachments.size(); ++a){
+        uint32_t r = group.attachments[a];
+        const resource &image = resources[r];
+        const vector<pair<uint32_t,uint32_t>> &timeline = timelines[r];
+        size_t first_in = 0;
+        while(passes[timeline[first_in].first].group != group_index) ++first_in;
+        size_t last_in = first_in;
+        while(last_in+1 < timeline.size() && passes[timeline[last_in+1].first].group == group_index) ++last_in;
+        const use &first = use_at(timeline[first_in]), &last = use_at(timeline[last_in]);
+        bool has_next = last_in+1 < timeline.size();
+        //reads with nothing before them were rejected by compile(), so a reading first use always has contents to load
+        bool load = first.reads;
+        bool keep = has_next ? use_at(timeline[last_in+1]).reads : image.exported;
+
+        VkAttachmentDescription &description = attachments[a];
+        description.flags = 0;
+        description.format = image.format;
+        description.samples = VK_SAMPLE_COUNT_1_BIT;
+        description.loadOp = first.discards ? VK_ATTACHMENT_LOAD_OP_CLEAR : load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.storeOp = keep ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.initialLayout = load ? current_layouts[r] : VK_IMAGE_LAYOUT_UNDEFINED;
+        if(has_next) description.finalLayout = keep ? use_at(timeline[last_in+1]).layout : last.layout;
+        else description.finalLayout = image.final_layout != VK_IMAGE_LAYOUT_UNDEFINED ? image.final_layout : last.layout;
+        current_layouts[r] = description.finalLayout;
+        if(first.discards) group.clear_values[a] = first.clear_value;
+
+        //within the render pass: every hazard between consecutive uses in different subpasses
+        for(size_t i = first_in; i <= last_in; ++i){
+            const use &u = use_at(timeline[i]);
+            unsigned int s = passes[timeline[i].first].subpass;
+            if(u.kind != use_kind::sampled){
+                first_subpass[a] = min(first_subpass[a],s);
+                last_subpass[a] = max(last_subpass[a],s);
+            }
+            if(i == last_in) continue;
+            const use &next = use_at(timeline[i+1]);
+            unsigned int next_s = passes[timeline[i+1].first].subpass;
+            if(next_s != s && (u.writes || next.writes)) depend(s,next_s,u.stages,u.access & write_access_mask,next.stages,next.access);
+        }
+
+        //into the render pass: on the previous use when loading, otherwise on everything that has touched the memory, which
+        //covers the previous frame, earlier occupants of an aliased slot and the swapchain's acquire semaphore wait
+        unsigned int first_s = passes[timeline[first_in].first].subpass;
+        if(load){
+            const use &previous = use_at(timeline[first_in-1]);
+            depend(VK_SUBPASS_EXTERNAL,first_s,previous.stages,previous.access & write_access_mask,first.stages,first.access);
+        }else{
+            VkPipelineStageFlags stages = 0;
+            VkAccessFlags access = 0;
+            if(image.kind == resource_kind::transient_image){
+                stages = alias_slots[image.alias].stages;
+                access = alias_slots[image.alias].write_access;
+            }else for(const auto &entry : timeline){
+                stages |= use_at(entry).stages;
+                access |= use_at(entry).access & write_access_mask;
+            }
+            depend(VK_SUBPASS_EXTERNAL,first_s,stages,access,first.stages,first.access);
+        }
+        //out of it: to the next use in a later group
+        if(has_next){
+            const use &next = use_at(timeline[last_in+1]);
+            depend(passes[timeline[last_in].first].subpass,VK_SUBPASS_EXTERNAL,last.stages,last.access & write_access_mask,next.stages,next.access);
+        }
+    }
+
+    vector<vector<VkAttachmentReference>> &color_references = result.color_references, &input_references = result.input_references;
+    vector<VkAttachmentReference> &depth_references = result.depth_references;
+    vector<vector<uint32_t>> &preserve_references = result.preserve_references;
+    vector<VkSubpassDescription> &subpasses = result.subpasses;
+    color_references.resize(subpass_count);
+    input_references.resize(subpass_count);
+    depth_references.resize(subpass_count);
+    preserve_references.resize(subpass_count);
+    subpasses.resize(subpass_count);
+    vector<bool> has_depth(subpass_count);
+    for(unsigned int s = 0; s < subpass_count; ++s){
+        vector<bool> referenced(group.attachments.size());
+        for(const use &u : passes[group.passes[s]].uses){
+            unsigned int a = find(group.attachments.begin(),group.attachments.end(),u.resource)-group.attachments.begin();
+            if(a == group.attachments.size()) continue;
+            if(u.kind == use_kind::color) color_references[s].push_back({a,VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+            else if(u.kind == use_kind::input) input_references[s].push_back({a,VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+            else if(u.kind == use_kind::depth){
+                depth_references[s] = {a,VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+                has_depth[s] = true;
+            }else continue;
+            referenced[a] = true;
+        }
+        //attachments used before and after this subpass but not in it
+        for(unsigned int a = 0; a < group.attachments.size(); ++a){
+            if(!referenced[a] && first_subpass[a] < s && last_subpass[a] > s) preserve_references[s].push_back(a);
+        }
+
+        VkSubpassDescription &subpass = subpasses[s];
+        subpass.flags = 0;
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.inputAttachmentCount = input_references[s].size();
+        subpass.pInputAttachments = input_references[s].data();
+        subpass.colorAttachmentCount = color_references[s].size();
+        subpass.pColorAttachments = color_references[s].data();
+        subpass.pResolveAttachments = nullptr;
+        subpass.pDepthStencilAttachment = has_depth[s] ? &depth_references[s] : nullptr;
+        subpass.preserveAttachmentCount = preserve_references[s].size();
+        subpass.pPreserveAttachments = preserve_references[s].data();
+    }
+    return result;
+}
+
+void render_graph::build_render_pass(pass_group &group, vector<VkImageLayout> &current_layouts){
+    render_pass_description description = describe_render_pass(group,current_layouts);
+    VkRenderPassCreateInfo renderpass_info {};
+    renderpass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderpass_info.pNext = nullptr;
+    renderpass_info.flags = 0;
+    renderpass_info.attachmentCount = description.attachments.size();
+    renderpass_info.pAttachments = description.attachments.data();
+    renderpass_info.subpassCount = description.subpasses.size();
+    renderpass_info.pSubpasses = description.subpasses.data();
+    renderpass_info.dependencyCount = description.dependencies.size();
+    renderpass_info.pDependencies = description.dependencies.data();
+
+    if(vkCreateRenderPass(logical_device,&renderpass_info,nullptr,&group.renderpass)!=VK_SUCCESS) throw runtime_error("Error creating renderpass");
+    group.dependency_count = description.dependencies.size();
+}
+
+void render_graph::resize(VkExtent2D extent, uint64_t retire_value){
+    if(groups.empty()) throw runtime_error("Render graph is not compiled");
+    retire(retire_value);
+    this->extent = extent;
+    transient_bytes = unaliased_bytes = 0;
+
+    VkImageCreateInfo image_info {};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.pNext = nullptr;
+    image_info.flags = 0;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.extent = {extent.width,extent.height,1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.queueFamilyIndexCount = 0;
+    image_info.pQueueFamilyIndices = nullptr;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    //each slot is sized for its largest occupant, an image the slot's memory types can not hold gets memory of its own,
+    //which only drops aliasing the render passes already wait for
+    vector<VkMemoryRequirements> slot_requirements(alias_slots.size(),VkMemoryRequirements{0,1,~0u});
+    vector<bool> slot_lazy(alias_slots.size(),true);
+    vector<pair<uint32_t,VkMemoryRequirements>> slot_images, own_images;
+    for(uint32_t r = 0; r < resources.size(); ++r){
+        resource &transient = resources[r];
+        if(transient.kind != resource_kind::transient_image || transient.alias == UINT_MAX) continue;
+
+        VkImageUsageFlags usage = 0;
+        for(const auto &entry : timelines[r]){
+            switch(use_at(entry).kind){
+            case use_kind::color: usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+            case use_kind::depth: usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+            case use_kind::input: usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT; break;
+            default: usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+            }
+        }
+        //never sampled means the contents never leave tile memory, which lazily allocated memory can back
+        bool lazy = !(usage & VK_IMAGE_USAGE_SAMPLED_BIT);
+        image_info.format = transient.format;
+        image_info.usage = usage|(lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+        if(vkCreateImage(logical_device,&image_info,nullptr,&transient.image)!=VK_SUCCESS) throw runtime_error("Error creating image");
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(logical_device,transient.image,&requirements);
+        unaliased_bytes += requirements.size;
+        VkMemoryRequirements &slot = slot_requirements[transient.alias];
+        if(!(slot.memoryTypeBits & requirements.memoryTypeBits)){
+            own_images.push_back({r,requirements});
+            continue;
+        }
+        slot.size = max(slot.size,requirements.size);
+        slot.alignment = max(slot.alignment,requirements.alignment);
+        slot.memoryTypeBits &= requirements.memoryTypeBits;
+        slot_lazy[transient.alias] = slot_lazy[transient.alias] && lazy;
+        slot_images.push_back({r,requirements});
+    }
+
+    vector<unsigned int> slot_memory(alias_slots.size(),UINT_MAX);
+    for(unsigned int i = 0; i < alias_slots.size(); ++i){
+        if(!slot_requirements[i].size) continue;
+        slot_memory[i] = transient_memory.size();
+        transient_memory.push_back(allocator.allocate(slot_requirements[i],false,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,slot_lazy[i] ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0));
+        transient_bytes += slot_requirements[i].size;
+    }
+    for(const auto &entry : slot_images){
+        const gpu_allocation &memory = transient_memory[slot_memory[resources[entry.first].alias]];
+        if(vkBindImageMemory(logical_device,resources[entry.first].image,memory.memory,memory.offset)!=VK_SUCCESS) throw runtime_error("Error binding image memory");
+    }
+    for(const auto &entry : own_images){
+        transient_memory.push_back(allocator.allocate(entry.second,false,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+        transient_bytes += entry.second.size;
+        if(vkBindImageMemory(logical_device,resources[entry.first].image,transient_memory.back().memory,transient_memory.back().offset)!=VK_SUCCESS) throw runtime_error("Error binding image memory");
+    }
+
+    VkImageViewCreateInfo image_view_info {};
+    image_view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    image_view_info.pNext = nullptr;
+    image_view_info.flags = 0;
+    image_view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    image_view_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    image_view_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    image_view_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    image_view_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    image_view_info.subresourceRange.baseMipLevel = 0;
+    image_view_info.subresourceRange.levelCount = 1;
+    image_view_info.subresourceRange.baseArrayLayer = 0;
+    image_view_info.subresourceRange.layerCount = 1;
+    for(resource &transient : resources){
+        if(transient.image == VK_NULL_HANDLE) continue;
+        image_view_info.image = transient.image;
+        image_view_info.format = transient.format;
+        image_view_info.subresourceRange.aspectMask = is_depth_format(transient.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        if(vkCreateImageView(logical_device,&image_view_info,nullptr,&transient.view)!=VK_SUCCESS) throw runtime_error("Error creating image view");
+    }
+}
+
+void render_graph::retire(uint64_t retire_value){
+    retired_set set;
+    set.retire_value = retire_value;
+    for(pass_group &group : groups){
+        for(const auto &cached : group.framebuffers) set.framebuffers.push_back(cached.second);
+        group.framebuffers.clear();
+    }
+    for(resource &transient : resources){
+        if(transient.kind != resource_kind::transient_image || transient.image == VK_NULL_HANDLE) continue;
+        set.views.push_back(transient.view);
+        set.images.push_back(transient.image);
+        transient.view = VK_NULL_HANDLE;
+        transient.image = VK_NULL_HANDLE;
+    }
+    set.allocations = move(transient_memory);
+    transient_memory.clear();
+    if(!set.framebuffers.empty() || !set.images.empty()) retired.push_back(move(set));
+}
+
+void render_graph::collect(uint64_t completed_value){
+    for(size_t i = 0; i < retired.size();){
+        if(completed_value >= retired[i].retire_value){
+            destroy_set(retired[i]);
+            retired.erase(retired.begin()+i);
+        }else ++i;
+    }
+}
+
+VkFramebuffer render_graph::group_framebuffer(pass_group &group){
+    if(!extent.width || !extent.height) throw runtime_error("Render graph has no extent, call resize() first");
+    vector<VkImageView> views(group.attachments.size());
+    for(unsigned int i = 0; i < views.size(); ++i){
+        views[i] = resources[group.attachments[i]].view;
+        if(views[i] == VK_NULL_HANDLE) throw runtime_error("Render graph image "+resources[group.attachments[i]].name+" is not bound");
+    }
+    //one framebuffer per combination of bound views, i.e. per swapchain image, until the next resize() retires them
+    for(const auto &cached : group.framebuffers) if(cached.first == views) return cached.second;
+
+    VkFramebufferCreateInfo framebuffer_info {};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.pNext = nullptr;
+    framebuffer_info.flags = 0;
+    framebuffer_info.renderPass = group.renderpass;
+    framebuffer_info.attachmentCount = views.size();
+    framebuffer_info.pAttachments = views.data();
+    framebuffer_info.width = extent.width;
+    framebuffer_info.height = extent.height;
+    framebuffer_info.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if(vkCreateFramebuffer(logical_device,&framebuffer_info,nullptr,&framebuffer)!=VK_SUCCESS) throw runtime_error("Error creating framebuffer");
+    group.framebuffers.push_back({move(views),framebuffer});
+    return framebuffer;
+}
+
+void render_graph::execute(VkCommandBuffer commandbuffer){
+    for(pass_group &group : groups){
+        if(group.src_stages){
+            VkMemoryBarrier barrier {};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.pNext = nullptr;
+            barrier.srcAccessMask = group.src_access;
+            barrier.dstAccessMask = group.dst_access;
+            vkCmdPipelineBarrier(commandbuffer,group.src_stages,group.dst_stages,0,1,&barrier,0,nullptr,0,nullptr);
+        }
+        if(!group.raster){
+            passes[group.passes[0]].execute(commandbuffer);
+            continue;
+        }
+
+        VkRenderPassBeginInfo renderpass_begin_info {};
+        renderpass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderpass_begin_info.pNext = nullptr;
+        renderpass_begin_info.renderPass = group.renderpass;
+        renderpass_begin_info.framebuffer = group_framebuffer(group);
+        renderpass_begin_info.renderArea.offset = {0,0};
+        renderpass_begin_info.renderArea.extent = extent;
+        renderpass_begin_info.clearValueCount = group.clear_values.size();
+        renderpass_begin_info.pClearValues = group.clear_values.data();
+
+        vkCmdBeginRenderPass(commandbuffer,&renderpass_begin_info,passes[group.passes[0]].contents);
+        for(unsigned int i = 0; i < group.passes.size(); ++i){
+            if(i) vkCmdNextSubpass(commandbuffer,passes[group.passes[i]].contents);
+            passes[group.passes[i]].execute(commandbuffer);
+        }
+        vkCmdEndRenderPass(commandbuffer);
+    }
+}
+
+void render_graph::report(FILE *out) const{
+    unsigned int kept_count = 0, render_passes = 0, subpasses = 0, dependencies = 0;
+    string culled;
+    for(const pass &p : passes){
+        if(p.kept) ++kept_count;
+        else culled += (culled.empty() ? "" : ", ")+p.name;
+    }
+    for(const pass_group &group : groups){
+        if(!group.raster) continue;
+        ++render_passes;
+        subpasses += group.passes.size();
+        dependencies += group.dependency_count;
+    }
+    fprintf(out,"render graph: %u of %zu passes kept, %u render passes (%u subpasses, %u dependencies), %u barriers, transient memory %.1f MiB (%.1f MiB without aliasing)\n",
+        kept_count,passes.size(),render_passes,subpasses,dependencies,barrier_count,transient_bytes/1048576.0,unaliased_bytes/1048576.0);
+    if(!culled.empty()) fprintf(out,"render graph: culled %s\n",culled.c_str());
+}
+
+void render_graph::destroy_set(retired_set &set){
+    for(VkFramebuffer framebuffer : set.framebuffers) vkDestroyFramebuffer(logical_device,framebuffer,nullptr);
+    for(VkImageView view : set.views) vkDestroyImageView(logical_device,view,nullptr);
+    for(VkImage image : set.images) vkDestroyImage(logical_device,image,nullptr);
+    for(const gpu_allocation &allocation : set.allocations) allocator.free(allocation);
+    set = retired_set();
+}
+
+void render_graph::destroy(){
+    retire(0);
+    for(retired_set &set : retired) destroy_set(set);
+    retired.clear();
+    for(pass_group &group : groups){
+        if(group.renderpass != VK_NULL_HANDLE) vkDestroyRenderPass(logical_device,group.renderpass,nullptr);
+        group.renderpass = VK_NULL_HANDLE;
+    }
+}
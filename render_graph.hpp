@@ -0,0 +1,168 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "gpu_allocator.hpp"
+
+//the frame as passes declaring the resources they read and write, compile() culls passes whose results nobody uses, merges
+//consecutive raster passes into subpasses of one VkRenderPass when they only meet through attachments, and derives load and
+//store ops, layout transitions, subpass dependencies and the pipeline barriers between everything else, transient attachments
+//only live within the frame and share memory when their lifetimes do not overlap
+//the graph covers one queue, cross-queue hand-offs (uploads, async compute) stay with the modules that own them, and imported
+//buffers are only ordered within the frame, their owners keep frames in flight apart
+class render_graph{
+public:
+    render_graph(VkDevice logical_device, gpu_allocator &allocator);
+
+    //an image owned outside the graph, e.g. the swapchain image, bound with bind_image() every frame, its contents are
+    //undefined when the frame starts and it is left in final_layout, imported images are always exported
+    uint32_t import_image(const char *name, VkFormat format, VkImageLayout final_layout);
+    //an image created by the graph at the graph extent
+    uint32_t create_transient(const char *name, VkFormat format);
+    //a buffer owned outside the graph, only used to order passes and derive barriers
+    uint32_t import_buffer(const char *name);
+    //keeps the passes writing resource even though no kept pass reads it
+    void export_resource(uint32_t resource);
+
+    //raster passes record inside a subpass with contents, compute passes outside any render pass
+    uint32_t add_raster_pass(const char *name, VkSubpassContents contents, const std::function<void(VkCommandBuffer)> &execute);
+    uint32_t add_compute_pass(const char *name, const std::function<void(VkCommandBuffer)> &execute);
+
+    //clear is null to keep the previous contents
+    void write_color(uint32_t pass, uint32_t image, const VkClearColorValue *clear);
+    void write_depth(uint32_t pass, uint32_t image, const VkClearDepthStencilValue *clear);
+    //a subpass input attachment, the only image read that lets a pass share a render pass with the image's writer
+    void read_input(uint32_t pass, uint32_t image);
+    //sampled in stages, which makes the writer finish its render pass first
+    void read_sampled(uint32_t pass, uint32_t image, VkPipelineStageFlags stages);
+    void read_buffer(uint32_t pass, uint32_t buffer, VkPipelineStageFlags stages, VkAccessFlags access);
+    void write_buffer(uint32_t pass, uint32_t buffer, VkPipelineStageFlags stages, VkAccessFlags access);
+
+    //call once every pass is declared, throws if a kept pass reads something nothing wrote
+    void compile();
+
+    //(re)creates the transient images at extent, framebuffers and transients made for the previous extent or image views are
+    //retired with retire_value, call after every swapchain recreate
+    void resize(VkExtent2D extent, uint64_t retire_value);
+    void collect(uint64_t completed_value);
+    void bind_image(uint32_t image, VkImageView view){ resources[image].view = view; }
+
+    bool kept(uint32_t pass) const { return passes[pass].kept; }
+    VkRenderPass render_pass(uint32_t pass) const { return groups[passes[pass].group].renderpass; }
+    uint32_t subpass(uint32_t pass) const { return passes[pass].subpass; }
+    //the framebuffer the pass renders into with the images bound now, created on first use
+    VkFramebuffer framebuffer(uint32_t pass){ return group_framebuffer(groups[passes[pass].group]); }
+
+    //records every kept pass in order with its barriers, render pass begins and subpass transitions
+    void execute(VkCommandBuffer commandbuffer);
+
+    void report(FILE *out) const;
+    void destroy();
+
+private:
+    //render_graph_test.cpp checks what compile() derives for a multi-pass graph
+    friend struct render_graph_test;
+
+    enum class resource_kind{ imported_image, transient_image, buffer };
+    enum class use_kind{ color, depth, input, sampled, buffer };
+
+    struct resource{
+        std::string name;
+        resource_kind kind;
+        VkFormat format;
+        VkImageLayout final_layout;
+        bool exported;
+        //bound for imported images, owned for transient ones
+        VkImageView view;
+        VkImage image;
+        //transient memory slot, shared by transients whose group ranges do not overlap
+        unsigned int alias;
+        unsigned int first_group, last_group;
+    };
+    struct use{
+        uint32_t resource;
+        use_kind kind;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageLayout layout;
+        //reads depend on earlier contents, discards overwrite all of them
+        bool reads, writes, discards;
+        VkClearValue clear_value;
+    };
+    struct pass{
+        std::string name;
+        bool raster;
+        VkSubpassContents contents;
+        std::function<void(VkCommandBuffer)> execute;
+        std::vector<use> uses;
+        bool kept;
+        unsigned int group, subpass;
+    };
+    //one VkRenderPass, or one compute pass
+    struct pass_group{
+        std::vector<uint32_t> passes;
+        bool raster;
+        VkRenderPass renderpass;
+        std::vector<uint32_t> attachments;
+        std::vector<VkClearValue> clear_values;
+        unsigned int dependency_count;
+        //a global memory barrier recorded ahead of the group for buffer hazards, skipped while src_stages is 0
+        VkPipelineStageFlags src_stages, dst_stages;
+        VkAccessFlags src_access, dst_access;
+        std::vector<std::pair<std::vector<VkImageView>,VkFramebuffer>> framebuffers;
+    };
+    struct alias_slot{
+        VkPipelineStageFlags stages;
+        VkAccessFlags write_access;
+        unsigned int last_group;
+    };
+    //everything vkCreateRenderPass is given for one group, the subpasses point into the reference vectors
+    struct render_pass_description{
+        std::vector<VkAttachmentDescription> attachments;
+        std::vector<std::vector<VkAttachmentReference>> color_references, input_references;
+        std::vector<VkAttachmentReference> depth_references;
+        std::vector<std::vector<uint32_t>> preserve_references;
+        std::vector<VkSubpassDescription> subpasses;
+        std::vector<VkSubpassDependency> dependencies;
+    };
+    //what resize() replaced, destroyed once the frames using it have completed
+    struct retired_set{
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkImageView> views;
+        std::vector<VkImage> images;
+        std::vector<gpu_allocation> allocations;
+        uint64_t retire_value;
+    };
+
+    uint32_t add_resource(const char *name, resource_kind kind, VkFormat format, VkImageLayout final_layout);
+    uint32_t add_pass(const char *name, bool raster, VkSubpassContents contents, const std::function<void(VkCommandBuffer)> &execute);
+    void add_use(uint32_t pass, const use &added);
+    bool can_merge(const pass_group &group, const pass &next) const;
+    const use &use_at(const std::pair<uint32_t,uint32_t> &entry) const { return passes[entry.first].uses[entry.second]; }
+    void assign_alias_slots();
+    void add_buffer_barriers();
+    //fills in the group's attachments and clear values and derives its render pass, current_layouts carries each image's
+    //layout from one group to the next
+    render_pass_description describe_render_pass(pass_group &group, std::vector<VkImageLayout> &current_layouts);
+    void build_render_pass(pass_group &group, std::vector<VkImageLayout> &current_layouts);
+    VkFramebuffer group_framebuffer(pass_group &group);
+    void retire(uint64_t retire_value);
+    void destroy_set(retired_set &set);
+
+    VkDevice logical_device;
+    gpu_allocator &allocator;
+    std::vector<resource> resources;
+    std::vector<pass> passes;
+    std::vector<pass_group> groups;
+    //(pass, use) of every kept use of each resource in recording order
+    std::vector<std::vector<std::pair<uint32_t,uint32_t>>> timelines;
+    std::vector<alias_slot> alias_slots;
+    VkExtent2D extent = {0,0};
+    std::vector<gpu_allocation> transient_memory;
+    VkDeviceSize transient_bytes = 0, unaliased_bytes = 0;
+    unsigned int barrier_count = 0;
+    std::vector<retired_set> retired;
+};
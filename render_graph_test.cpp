@@ -0,0 +1,253 @@
+#include "render_graph.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+//compiles a fixed multi-pass graph (a buffer hand-off from compute, a culled pass, two merged subpasses, an attachment cleared
+//again after its readers and a sampled read across render passes) on a real device and checks the culling, grouping, aliasing,
+//load and store ops, layouts, dependencies and barriers derived for it, the frame's own graph is a single pass and never gets there
+struct render_graph_test{
+    static void run(VkDevice logical_device, gpu_allocator &allocator);
+    static void check_graph(render_graph &graph);
+};
+
+static void check(bool passed, const char *what){
+    if(!passed) throw runtime_error(string("Render graph check failed: ")+what);
+}
+
+void render_graph_test::run(VkDevice logical_device, gpu_allocator &allocator){
+    render_graph graph(logical_device,allocator);
+    try{
+        check_graph(graph);
+    }catch(...){
+        graph.destroy();
+        throw;
+    }
+    //the transients are created and bound for real, so the driver (and the validation layer when installed) sees them as well
+    graph.resize({64,64},0);
+    graph.destroy();
+}
+
+void render_graph_test::check_graph(render_graph &graph){
+    const VkClearColorValue clear_color = {{0,0,0,1}};
+    const VkClearDepthStencilValue clear_depth = {1,0};
+    auto nothing = [](VkCommandBuffer){};
+
+    const uint32_t out = graph.import_image("out",VK_FORMAT_R8G8B8A8_UNORM,VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    const uint32_t gbuffer = graph.create_transient("gbuffer",VK_FORMAT_R8G8B8A8_UNORM);
+    const uint32_t depth = graph.create_transient("depth",VK_FORMAT_D16_UNORM);
+    const uint32_t lit = graph.create_transient("lit",VK_FORMAT_R8G8B8A8_UNORM);
+    const uint32_t bloom = graph.create_transient("bloom",VK_FORMAT_R8G8B8A8_UNORM);
+    const uint32_t unused = graph.create_transient("unused",VK_FORMAT_R8G8B8A8_UNORM);
+    const uint32_t particles = graph.import_buffer("particles");
+    graph.export_resource(particles);
+
+    const uint32_t simulate = graph.add_compute_pass("simulate",nothing);
+    graph.write_buffer(simulate,particles,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_WRITE_BIT);
+    const uint32_t geometry = graph.add_raster_pass("geometry",VK_SUBPASS_CONTENTS_INLINE,nothing);
+    graph.read_buffer(geometry,particles,VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT);
+    graph.write_color(geometry,gbuffer,&clear_color);
+    graph.write_depth(geometry,depth,&clear_depth);
+    const uint32_t culled = graph.add_raster_pass("culled",VK_SUBPASS_CONTENTS_INLINE,nothing);
+    graph.write_color(culled,unused,&clear_color);
+    const uint32_t lighting = graph.add_raster_pass("lighting",VK_SUBPASS_CONTENTS_INLINE,nothing);
+    graph.read_input(lighting,gbuffer);
+    graph.write_color(lighting,lit,&clear_color);
+    //clears gbuffer again once lighting has read it, which must not be folded into the render pass that wrote it
+    const uint32_t reuse = graph.add_raster_pass("reuse",VK_SUBPASS_CONTENTS_INLINE,nothing);
+    graph.write_color(reuse,gbuffer,&clear_color);
+    graph.write_color(reuse,bloom,&clear_color);
+    const uint32_t composite = graph.add_raster_pass("composite",VK_SUBPASS_CONTENTS_INLINE,nothing);
+    graph.read_sampled(composite,lit,VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    graph.read_input(composite,gbuffer);
+    graph.read_input(composite,bloom);
+    graph.write_color(composite,out,&clear_color);
+    const uint32_t resimulate = graph.add_compute_pass("resimulate",nothing);
+    graph.write_buffer(resimulate,particles,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_WRITE_BIT);
+    graph.compile();
+
+    check(!graph.kept(culled) && graph.kept(simulate) && graph.kept(geometry) && graph.kept(lighting) && graph.kept(reuse) && graph.kept(composite) && graph.kept(resimulate),"culling");
+    check(graph.groups.size() == 4,"group count");
+    check(graph.render_pass(lighting) == graph.render_pass(geometry) && graph.subpass(lighting) == 1,"lighting merged into geometry");
+    check(graph.render_pass(reuse) != graph.render_pass(geometry),"a later clear starts a new render pass");
+    check(graph.render_pass(composite) == graph.render_pass(reuse) && graph.subpass(composite) == 1,"composite merged into reuse");
+    check(graph.resources[unused].alias == UINT_MAX && graph.resources[bloom].alias == graph.resources[depth].alias && graph.resources[lit].alias != graph.resources[gbuffer].alias,"alias slots");
+
+    //derived again in group order, the same way compile() carried the layouts from one render pass to the next
+    vector<render_graph::render_pass_description> descriptions(graph.groups.size());
+    vector<VkImageLayout> current_layouts(graph.resources.size(),VK_IMAGE_LAYOUT_UNDEFINED);
+    for(unsigned int i = 0; i < graph.groups.size(); ++i){
+        if(graph.groups[i].raster) descriptions[i] = graph.describe_render_pass(graph.groups[i],current_layouts);
+    }
+    auto attachment = [&](uint32_t pass, uint32_t image) -> const VkAttachmentDescription& {
+        unsigned int group = graph.passes[pass].group;
+        const vector<uint32_t> &attachments = graph.groups[group].attachments;
+        size_t a = find(attachments.begin(),attachments.end(),image)-attachments.begin();
+        check(a < descriptions[group].attachments.size(),"attachment missing");
+        return descriptions[group].attachments[a];
+    };
+    auto ops = [](const VkAttachmentDescription &description, VkAttachmentLoadOp load, VkAttachmentStoreOp store, VkImageLayout initial_layout, VkImageLayout final_layout){
+        return description.loadOp == load && description.storeOp == store && description.initialLayout == initial_layout && description.finalLayout == final_layout;
+    };
+    //gbuffer is consumed inside the first render pass, so it is not stored, lit is sampled later so it is stored and left readable
+    check(ops(attachment(geometry,gbuffer),VK_ATTACHMENT_LOAD_OP_CLEAR,VK_ATTACHMENT_STORE_OP_DONT_CARE,VK_IMAGE_LAYOUT_UNDEFINED,VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),"gbuffer in geometry");
+    check(ops(attachment(geometry,depth),VK_ATTACHMENT_LOAD_OP_CLEAR,VK_ATTACHMENT_STORE_OP_DONT_CARE,VK_IMAGE_LAYOUT_UNDEFINED,VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL),"depth in geometry");
+    check(ops(attachment(lighting,lit),VK_ATTACHMENT_LOAD_OP_CLEAR,VK_ATTACHMENT_STORE_OP_STORE,VK_IMAGE_LAYOUT_UNDEFINED,VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),"lit in lighting");
+    check(ops(attachment(reuse,gbuffer),VK_ATTACHMENT_LOAD_OP_CLEAR,VK_ATTACHMENT_STORE_OP_DONT_CARE,VK_IMAGE_LAYOUT_UNDEFINED,VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),"gbuffer in reuse");
+    check(ops(attachment(composite,out),VK_ATTACHMENT_LOAD_OP_CLEAR,VK_ATTACHMENT_STORE_OP_STORE,VK_IMAGE_LAYOUT_UNDEFINED,VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL),"out in composite");
+
+    auto dependency = [&](uint32_t pass, uint32_t src, uint32_t dst, VkAccessFlags src_access, VkAccessFlags dst_access, VkDependencyFlags flags){
+        for(const VkSubpassDependency &d : descriptions[graph.passes[pass].group].dependencies){
+            if(d.srcSubpass == src && d.dstSubpass == dst) return (d.srcAccessMask & src_access) == src_access && (d.dstAccessMask & dst_access) == dst_access && d.dependencyFlags == flags;
+        }
+        return false;
+    };
+    check(dependency(geometry,0,1,VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,VK_DEPENDENCY_BY_REGION_BIT),"geometry to lighting");
+    check(dependency(lighting,1,VK_SUBPASS_EXTERNAL,VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT,0),"lighting to the sampled read");
+    check(dependency(composite,0,1,VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,VK_DEPENDENCY_BY_REGION_BIT),"reuse to composite");
+
+    //the particle buffer: written by compute then read by the vertex shader, and read before being written again
+    const render_graph::pass_group &geometry_group = graph.groups[graph.passes[geometry].group], &resimulate_group = graph.groups[graph.passes[resimulate].group];
+    check(graph.barrier_count == 2,"barrier count");
+    check(geometry_group.src_stages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT && geometry_group.src_access == VK_ACCESS_SHADER_WRITE_BIT &&
+        geometry_group.dst_stages == VK_PIPELINE_STAGE_VERTEX_SHADER_BIT && geometry_group.dst_access == VK_ACCESS_SHADER_READ_BIT,"read after write barrier");
+    check((resimulate_group.src_stages & VK_PIPELINE_STAGE_VERTEX_SHADER_BIT) && (resimulate_group.dst_stages & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT),"write after read barrier");
+}
+
+static unsigned int validation_errors = 0;
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL count_errors(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT /*message_flags*/, const VkDebugUtilsMessengerCallbackDataEXT *callback_data, void */*user_data*/){
+    if(message_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT){
+        ++validation_errors;
+        fprintf(stderr,"%s\n",callback_data->pMessage);
+    }
+    return VK_FALSE;
+}
+
+int main(){
+    //77 tells meson the test was skipped, machines without a Vulkan device have nothing to check against
+    const char *validation_layer = "VK_LAYER_KHRONOS_validation";
+    unsigned int layer_count;
+    vkEnumerateInstanceLayerProperties(&layer_count,nullptr);
+    vector<VkLayerProperties> layers(layer_count);
+    vkEnumerateInstanceLayerProperties(&layer_count,layers.data());
+    bool validation = false;
+    for(const VkLayerProperties &layer : layers) validation |= !strcmp(layer.layerName,validation_layer);
+    const char *debug_extension = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+
+    VkApplicationInfo app_info {};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pNext = nullptr;
+    app_info.pApplicationName = "render graph test";
+    app_info.applicationVersion = VK_MAKE_VERSION(1,0,0);
+    app_info.pEngineName = "No Engine";
+    app_info.engineVersion = VK_MAKE_VERSION(1,0,0);
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    VkInstanceCreateInfo instance_info {};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pNext = nullptr;
+    instance_info.flags = 0;
+    instance_info.pApplicationInfo = &app_info;
+    instance_info.enabledLayerCount = validation ? 1 : 0;
+    instance_info.ppEnabledLayerNames = &validation_layer;
+    instance_info.enabledExtensionCount = validation ? 1 : 0;
+    instance_info.ppEnabledExtensionNames = &debug_extension;
+    VkInstance instance;
+    if(vkCreateInstance(&instance_info,nullptr,&instance)!=VK_SUCCESS){
+        fprintf(stderr,"no Vulkan instance, skipping\n");
+        return 77;
+    }
+
+    VkDebugUtilsMessengerEXT debug_messenger = VK_NULL_HANDLE;
+    auto create_messenger = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance,"vkCreateDebugUtilsMessengerEXT");
+    auto destroy_messenger = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance,"vkDestroyDebugUtilsMessengerEXT");
+    if(validation && create_messenger){
+        VkDebugUtilsMessengerCreateInfoEXT messenger_info {};
+        messenger_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+        messenger_info.pNext = nullptr;
+        messenger_info.flags = 0;
+        messenger_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT|VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+        messenger_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT|VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+        messenger_info.pfnUserCallback = count_errors;
+        messenger_info.pUserData = nullptr;
+        if(create_messenger(instance,&messenger_info,nullptr,&debug_messenger)!=VK_SUCCESS) debug_messenger = VK_NULL_HANDLE;
+    }
+
+    //the first device with a graphics queue, the graph only records for one
+    unsigned int device_count = 0;
+    vkEnumeratePhysicalDevices(instance,&device_count,nullptr);
+    vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(instance,&device_count,devices.data());
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    unsigned int graphics_family = 0;
+    for(VkPhysicalDevice candidate : devices){
+        unsigned int family_count;
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate,&family_count,nullptr);
+        vector<VkQueueFamilyProperties> families(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate,&family_count,families.data());
+        for(unsigned int i = 0; i < family_count && physical_device == VK_NULL_HANDLE; ++i){
+            if(!(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) continue;
+            physical_device = candidate;
+            graphics_family = i;
+        }
+        if(physical_device != VK_NULL_HANDLE) break;
+    }
+    if(physical_device == VK_NULL_HANDLE){
+        fprintf(stderr,"no Vulkan device with a graphics queue, skipping\n");
+        if(debug_messenger != VK_NULL_HANDLE) destroy_messenger(instance,debug_messenger,nullptr);
+        vkDestroyInstance(instance,nullptr);
+        return 77;
+    }
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info {};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.pNext = nullptr;
+    queue_info.flags = 0;
+    queue_info.queueFamilyIndex = graphics_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkDeviceCreateInfo device_info {};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pNext = nullptr;
+    device_info.flags = 0;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.enabledLayerCount = 0;
+    device_info.ppEnabledLayerNames = nullptr;
+    device_info.enabledExtensionCount = 0;
+    device_info.ppEnabledExtensionNames = nullptr;
+    device_info.pEnabledFeatures = nullptr;
+    VkDevice logical_device;
+    if(vkCreateDevice(physical_device,&device_info,nullptr,&logical_device)!=VK_SUCCESS){
+        fprintf(stderr,"Error creating device\n");
+        return 1;
+    }
+
+    int result = 0;
+    {
+        gpu_allocator allocator(physical_device,logical_device);
+        try{
+            render_graph_test::run(logical_device,allocator);
+        }catch(const exception &error){
+            fprintf(stderr,"%s\n",error.what());
+            result = 1;
+        }
+        allocator.destroy();
+    }
+    vkDestroyDevice(logical_device,nullptr);
+    if(debug_messenger != VK_NULL_HANDLE) destroy_messenger(instance,debug_messenger,nullptr);
+    vkDestroyInstance(instance,nullptr);
+
+    if(validation_errors){
+        fprintf(stderr,"%u validation errors\n",validation_errors);
+        result = 1;
+    }
+    if(!result) printf("render graph: all checks passed%s\n",validation ? " (validation layer on)" : "");
+    return result;
+}
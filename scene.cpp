@@ -0,0 +1,57 @@
+#include "scene.hpp"
+#include <cmath>
+using namespace std;
+
+instanced_scene::instanced_scene(unsigned int object_count, unsigned int material_count) : x(object_count), y(object_count), scale(object_count), material_count(max(material_count,1u)) {
+    unsigned int side = ceil(sqrt((double)object_count));
+    //a single object keeps the original centered triangle
+    float half_extent = side > 1 ? 2.0f : 0.5f, spacing = 2*half_extent/max(side,1u);
+    pan = half_extent-1 > 0 ? half_extent-1 : 0;
+    max_drift = spacing*0.1f;
+    for(unsigned int i = 0; i < object_count; ++i){
+        x[i] = -half_extent+(i%side+0.5f)*spacing;
+        y[i] = -half_extent+(i/side+0.5f)*spacing;
+        scale[i] = object_count == 1 ? 1.0f : spacing*0.8f;
+    }
+}
+
+void instanced_scene::camera_at(unsigned int frame, float camera[2]) const{
+    camera[0] = pan*sin(frame*0.01f);
+    camera[1] = pan*cos(frame*0.013f);
+}
+
+bool instanced_scene::visible(unsigned int i, const float camera[2]) const{
+    //the triangle fits in a box of half size 0.5*scale around its instance position, wherever the particle pass moved it
+    float radius = 0.5f*scale[i]+max_drift;
+    return fabs(x[i]-camera[0]) <= 1+radius && fabs(y[i]-camera[1]) <= 1+radius;
+}
+
+unsigned int instanced_scene::cull_indirect(const float camera[2], vector<VkDrawIndexedIndirectCommand> &commands, vector<material_run> &runs) const{
+    commands.clear();
+    runs.clear();
+    //the open command is kept in locals and only appended once the next visible object can not extend it
+    unsigned int visible_count = 0, first_instance = 0, instance_count = 0;
+    auto close_command = [&]{
+        if(instance_count) commands.push_back({3,instance_count,0,0,first_instance});
+    };
+    for(unsigned int i = 0; i < x.size(); ++i){
+        if(!visible(i,camera)) continue;
+        ++visible_count;
+        if(instance_count && first_instance+instance_count == i && runs.back().material == material(i)){
+            ++instance_count;
+            continue;
+        }
+        close_command();
+        if(runs.empty() || runs.back().material != material(i)) runs.push_back({material(i),(unsigned int)commands.size(),0});
+        ++runs.back().command_count;
+        first_instance = i;
+        instance_count = 1;
+    }
+    close_command();
+    return visible_count;
+}
+
+void instanced_scene::cull_direct(const float camera[2], vector<draw_item> &draws) const{
+    draws.clear();
+    for(unsigned int i = 0; i < x.size(); ++i) if(visible(i,camera)) draws.push_back({3,1,0,i,material(i)});
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "parallel_recorder.hpp"
+
+//a run of consecutive indirect commands drawing one material
+struct material_run{
+    unsigned int material, first_command, command_count;
+};
+
+//object_count triangles on a square grid, larger than the view once there is more than one, with per-instance data kept as
+//structure of arrays so each shader read (and the culling loop) walks one tightly packed array
+class instanced_scene{
+public:
+    //material_count materials are assigned in contiguous blocks of objects, so neighbouring draws mostly share one
+    instanced_scene(unsigned int object_count, unsigned int material_count);
+
+    unsigned int size() const { return x.size(); }
+    const std::vector<float> &instance_x() const { return x; }
+    const std::vector<float> &instance_y() const { return y; }
+    const std::vector<float> &instance_scale() const { return scale; }
+    //the particle pass moves each instance by at most this along each axis, culling widens every bound by it
+    float drift() const { return max_drift; }
+    unsigned int materials() const { return material_count; }
+    unsigned int material(unsigned int i) const { return (uint64_t)i*material_count/x.size(); }
+
+    //the camera pans across the grid so culling has work to do
+    void camera_at(unsigned int frame, float camera[2]) const;
+
+    //objects intersecting the [-1,1] view, contiguous visible runs of one material are merged into one instanced command,
+    //runs gets the commands grouped by material, returns the visible object count, the list is built in cached memory so
+    //callers copy it into a mapped buffer in one go instead of read-modify-writing a write-combined mapping
+    unsigned int cull_indirect(const float camera[2], std::vector<VkDrawIndexedIndirectCommand> &commands, std::vector<material_run> &runs) const;
+    //one draw per visible object, for the per-object vkCmdDraw path
+    void cull_direct(const float camera[2], std::vector<draw_item> &draws) const;
+
+private:
+    bool visible(unsigned int i, const float camera[2]) const;
+
+    std::vector<float> x, y, scale;
+    float pan, max_drift;
+    unsigned int material_count;
+};
@@ -2,8 +2,23 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(location=0) in vec3 frag_color;
+layout(location=1) in vec2 frag_uv;
 layout(location=0) out vec4 color;
 
+//the whole bindless table, or the one texture bound for the current material
+layout(constant_id=0) const uint material_capacity = 1;
+layout(set=1,binding=0) uniform sampler2D material_textures[material_capacity];
+//0: vertex color times the material texture, 1: the texture alone, 2: the vertex color alone, without sampling
+layout(constant_id=1) const uint color_mode = 0;
+
+layout(push_constant) uniform material_index{ layout(offset=8) uint material; };
+
+//color_mode is known when the pipeline is created, so each variant compiles down to one of the three paths
 void main(){
-    color = vec4(frag_color,1.0);
+    if(color_mode == 2){
+        color = vec4(frag_color,1.0);
+        return;
+    }
+    vec4 texel = texture(material_textures[material],frag_uv);
+    color = color_mode == 1 ? texel : vec4(frag_color,1.0)*texel;
 }
\ No newline at end of file
@@ -1,20 +1,23 @@
 #version 450 
 #extension GL_ARB_separate_shader_objects : enable
 
-vec2 positions[3] = vec2[](
-    vec2(-0.5, 0.5),
-    vec2( 0.0,-0.5),
-    vec2( 0.5, 0.5)
-);
+layout(location=0) in vec2 position;
+layout(location=1) in vec3 color;
 
-vec3 colors[3] = vec3[](
-    vec3(1,0,0),
-    vec3(0,1,0),
-    vec3(0,0,1)
-);
+//per-instance data as structure of arrays, indexed by gl_InstanceIndex (which includes firstInstance)
+layout(std430,set=0,binding=0) readonly buffer instance_x_array{ float instance_x[]; };
+layout(std430,set=0,binding=1) readonly buffer instance_y_array{ float instance_y[]; };
+layout(std430,set=0,binding=2) readonly buffer instance_scale_array{ float instance_scale[]; };
+//written by particles.comp for this frame
+layout(std430,set=0,binding=3) readonly buffer instance_offset_array{ vec2 instance_offset[]; };
+
+layout(push_constant) uniform view{ vec2 camera; };
 
 layout(location=0) out vec3 frag_color;
+layout(location=1) out vec2 frag_uv;
 void main(){
-    gl_Position = vec4(positions[gl_VertexIndex],0.0,1.0);
-    frag_color = colors[gl_VertexIndex];
+    int i = gl_InstanceIndex;
+    gl_Position = vec4(position*instance_scale[i]+vec2(instance_x[i],instance_y[i])+instance_offset[i]-camera,0.0,1.0);
+    frag_color = color;
+    frag_uv = position+0.5;
 }
\ No newline at end of file
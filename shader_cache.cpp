@@ -0,0 +1,82 @@
+#include "shader_cache.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+mapped_file::mapped_file(const char *path){
+    int fd = open(path,O_RDONLY);
+    if(fd < 0) throw runtime_error(string("Error opening shader path ")+path);
+    struct stat info;
+    if(fstat(fd,&info) || info.st_size <= 0){
+        close(fd);
+        throw runtime_error(string("Error reading shader ")+path);
+    }
+    length = info.st_size;
+    address = mmap(nullptr,length,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(address == MAP_FAILED){
+        address = nullptr;
+        throw runtime_error(string("Error mapping shader ")+path);
+    }
+}
+
+mapped_file::~mapped_file(){
+    if(address) munmap(address,length);
+}
+
+//FNV-1a over 32-bit words, SPIR-V is always a whole number of words
+static uint64_t hash_words(const uint32_t *words, size_t count){
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i < count; ++i){
+        hash ^= words[i];
+        hash *= 1099511628211ull;
+    }
+    return hash^count;
+}
+
+VkShaderModule shader_cache::load(const char *path){
+    auto loaded = paths.find(path);
+    if(loaded != paths.end()){
+        ++hits;
+        return loaded->second;
+    }
+
+    //a new path can still hold SPIR-V already loaded from another one
+    mapped_file file(path);
+    //mappings are page aligned, so the words can be read in place
+    const uint32_t *words = static_cast<const uint32_t*>(file.data());
+    if(file.size()%4 || file.size() < 20 || words[0] != 0x07230203) throw runtime_error(string("Not a SPIR-V binary: ")+path);
+
+    const size_t word_count = file.size()/4;
+    vector<cached_module> &bucket = modules[hash_words(words,word_count)];
+    for(const cached_module &existing : bucket){
+        if(existing.words.size() != word_count || memcmp(existing.words.data(),words,file.size())) continue;
+        ++hits;
+        paths.emplace(path,existing.module);
+        return existing.module;
+    }
+    ++misses;
+
+    VkShaderModuleCreateInfo module_info {};
+    module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    module_info.pNext = nullptr;
+    module_info.pCode = words;
+    module_info.flags = 0;
+    module_info.codeSize = file.size();
+    VkShaderModule shadermodule;
+    if(vkCreateShaderModule(logical_device,&module_info,nullptr,&shadermodule)!=VK_SUCCESS) throw runtime_error("Error creating shader module");
+    bucket.push_back({vector<uint32_t>(words,words+word_count),shadermodule});
+    paths.emplace(path,shadermodule);
+    return shadermodule;
+}
+
+void shader_cache::destroy(){
+    for(auto &bucket : modules) for(const cached_module &cached : bucket.second) vkDestroyShaderModule(logical_device,cached.module,nullptr);
+    modules.clear();
+    paths.clear();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+//read-only memory mapping of a whole file, unmapped on destruction
+class mapped_file{
+public:
+    explicit mapped_file(const char *path);
+    ~mapped_file();
+    mapped_file(const mapped_file&) = delete;
+    mapped_file &operator=(const mapped_file&) = delete;
+
+    const void *data() const { return address; }
+    size_t size() const { return length; }
+
+private:
+    void *address = nullptr;
+    size_t length = 0;
+};
+
+//VkShaderModules keyed by a hash of their SPIR-V, so rebuilding a pipeline from the same .spv reuses the module, paths already
+//loaded are looked up first so a repeat load never touches the file
+class shader_cache{
+public:
+    explicit shader_cache(VkDevice logical_device) : logical_device(logical_device) {}
+
+    //maps path and hands the mapping straight to vkCreateShaderModule, the module stays owned by the cache, a file changed on
+    //disk after its first load is not picked up
+    VkShaderModule load(const char *path);
+    void destroy();
+
+    unsigned int hits = 0, misses = 0;
+
+private:
+    //the SPIR-V is kept next to its module, a hash hit only reuses the module once the words compare equal
+    struct cached_module{
+        std::vector<uint32_t> words;
+        VkShaderModule module;
+    };
+
+    VkDevice logical_device;
+    //every module whose SPIR-V hashes to the key, more than one only on a collision
+    std::unordered_map<uint64_t,std::vector<cached_module>> modules;
+    std::unordered_map<std::string,VkShaderModule> paths;
+};
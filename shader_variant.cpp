@@ -0,0 +1,46 @@
+#include "shader_variant.hpp"
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+shader_variant &shader_variant::set(uint32_t constant_id, uint32_t value){
+    if(constant_id >= max_constants) throw runtime_error("Specialization constant id "+to_string(constant_id)+" out of range");
+    mask |= 1u<<constant_id;
+    values[constant_id] = value;
+    return *this;
+}
+
+bool shader_variant::operator==(const shader_variant &other) const{
+    if(mask != other.mask) return false;
+    for(uint32_t i = 0; i < max_constants; ++i) if(mask & 1u<<i && values[i] != other.values[i]) return false;
+    return true;
+}
+
+uint64_t shader_variant::hash(uint64_t seed) const{
+    seed ^= mask;
+    seed *= 1099511628211ull;
+    for(uint32_t i = 0; i < max_constants; ++i){
+        if(!(mask & 1u<<i)) continue;
+        seed ^= values[i];
+        seed *= 1099511628211ull;
+    }
+    return seed;
+}
+
+VkSpecializationInfo shader_variant::info(VkSpecializationMapEntry *entries) const{
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < max_constants; ++i){
+        if(!(mask & 1u<<i)) continue;
+        entries[count].constantID = i;
+        entries[count].offset = i*sizeof(uint32_t);
+        entries[count].size = sizeof(uint32_t);
+        ++count;
+    }
+
+    VkSpecializationInfo specialization {};
+    specialization.mapEntryCount = count;
+    specialization.pMapEntries = entries;
+    specialization.dataSize = sizeof(values);
+    specialization.pData = values;
+    return specialization;
+}
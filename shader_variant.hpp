@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+//specialization constant values for one shader stage, a variant is a handful of uint32 constants picked at pipeline creation
+//rather than a separate .spv per permutation, so the driver folds away whatever they select, constants never set keep the
+//default written in the shader, bools are passed as 0 or 1
+struct shader_variant{
+    static const uint32_t max_constants = 4;
+    //bit i set when constant_id i has a value
+    uint32_t mask = 0;
+    uint32_t values[max_constants] = {};
+
+    //throws for constant ids past max_constants
+    shader_variant &set(uint32_t constant_id, uint32_t value);
+    bool operator==(const shader_variant &other) const;
+    //FNV-1a over the set constants
+    uint64_t hash(uint64_t seed) const;
+
+    //entries needs room for max_constants, the returned info points into entries and this variant, so both must outlive it
+    VkSpecializationInfo info(VkSpecializationMapEntry *entries) const;
+};
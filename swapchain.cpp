@@ -0,0 +1,157 @@
+#include "swapchain.hpp"
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+swapchain_manager::swapchain_manager(VkPhysicalDevice physical_device, VkDevice logical_device, gpu_allocator &allocator, VkSurfaceKHR surface,
+    VkSurfaceFormatKHR surface_format, VkPresentModeKHR present_mode, unsigned int queue_family, unsigned int image_count)
+    : physical_device(physical_device), logical_device(logical_device), allocator(allocator), surface(surface), surface_format(surface_format),
+      present_mode(present_mode), queue_family(queue_family), requested_image_count(image_count) {}
+
+bool swapchain_manager::recreate(VkExtent2D window_extent, uint64_t retire_value){
+    image_set next;
+    VkExtent2D extent = window_extent;
+    vector<VkImage> images;
+
+    if(surface == VK_NULL_HANDLE){
+        if(!extent.width || !extent.height) return false;
+
+        VkImageCreateInfo image_info {};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.pNext = nullptr;
+        image_info.flags = 0;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = surface_format.format;
+        image_info.extent = {extent.width,extent.height,1};
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT|VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.queueFamilyIndexCount = 0;
+        image_info.pQueueFamilyIndices = nullptr;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        for(unsigned int i = 0; i < requested_image_count; ++i){
+            next.offscreen.push_back(allocator.create_image(image_info,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+            images.push_back(next.offscreen.back().image);
+        }
+    }else{
+        VkSurfaceCapabilitiesKHR surface_capabilities;
+        if(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device,surface,&surface_capabilities)!=VK_SUCCESS) throw runtime_error("Error querying surface capabilities");
+        if(surface_capabilities.currentExtent.width != UINT32_MAX) extent = surface_capabilities.currentExtent;
+        else{
+            extent.width  = max(surface_capabilities.minImageExtent.width,min(surface_capabilities.maxImageExtent.width,extent.width));
+            extent.height = max(surface_capabilities.minImageExtent.height,min(surface_capabilities.maxImageExtent.height,extent.height));
+        }
+        if(!extent.width || !extent.height) return false;
+
+        unsigned int min_image_count = surface_capabilities.minImageCount+requested_image_count;
+        if(surface_capabilities.maxImageCount) min_image_count = min(min_image_count,surface_capabilities.maxImageCount);
+
+        VkSwapchainCreateInfoKHR swapchain_info {};
+        swapchain_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        swapchain_info.surface = surface;
+        swapchain_info.queueFamilyIndexCount = 1;
+        swapchain_info.preTransform = surface_capabilities.currentTransform;
+        swapchain_info.presentMode = present_mode;
+        swapchain_info.pQueueFamilyIndices = &queue_family;
+        swapchain_info.pNext = nullptr;
+        //lets the driver hand resources over from the old swapchain, which stays valid for images already acquired from it
+        swapchain_info.oldSwapchain = current.swapchain;
+        swapchain_info.minImageCount = min_image_count;
+        swapchain_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        swapchain_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        swapchain_info.imageFormat = surface_format.format;
+        swapchain_info.imageExtent = extent;
+        swapchain_info.imageColorSpace = surface_format.colorSpace;
+        swapchain_info.imageArrayLayers = 1;
+        swapchain_info.flags = 0;
+        swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        swapchain_info.clipped = VK_TRUE;
+
+        if(vkCreateSwapchainKHR(logical_device,&swapchain_info,nullptr,&next.swapchain)!=VK_SUCCESS) throw runtime_error("Error creating swapchain");
+        unsigned int swapchain_image_count;
+        vkGetSwapchainImagesKHR(logical_device,next.swapchain,&swapchain_image_count,nullptr);
+        images.resize(swapchain_image_count);
+        vkGetSwapchainImagesKHR(logical_device,next.swapchain,&swapchain_image_count,images.data());
+    }
+
+    VkImageViewCreateInfo image_view_info {};
+    image_view_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    image_view_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    image_view_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    image_view_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    image_view_info.flags = 0;
+    image_view_info.format = surface_format.format;
+    image_view_info.pNext = nullptr;
+    image_view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    image_view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_view_info.subresourceRange.baseArrayLayer = 0;
+    image_view_info.subresourceRange.baseMipLevel = 0;
+    image_view_info.subresourceRange.layerCount = 1;
+    image_view_info.subresourceRange.levelCount = 1;
+    image_view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+    next.views.resize(images.size());
+    for(unsigned int i = 0; i < images.size(); ++i){
+        image_view_info.image = images[i];
+        if(vkCreateImageView(logical_device,&image_view_info,nullptr,&next.views[i])!=VK_SUCCESS) throw runtime_error("Error creating image view");
+    }
+
+    if(!current.views.empty()){
+        current.retire_value = retire_value;
+        retired.push_back(move(current));
+        ++recreates;
+    }
+    current = move(next);
+    current_extent = extent;
+    return true;
+}
+
+void swapchain_manager::collect(uint64_t completed_value){
+    //the timeline only covers rendering, a frame of the new set completing as well is what keeps the old set's last
+    //presents, queued ahead of it, from still being in use
+    for(size_t i = 0; i < retired.size();){
+        if(completed_value > retired[i].retire_value){
+            destroy_set(retired[i]);
+            retired.erase(retired.begin()+i);
+        }else ++i;
+    }
+}
+
+VkResult swapchain_manager::acquire(VkSemaphore image_available, unsigned int &image_index){
+    VkResult result = vkAcquireNextImageKHR(logical_device,current.swapchain,UINT64_MAX,image_available,VK_NULL_HANDLE,&image_index);
+    if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) throw runtime_error("Error acquiring image");
+    return result;
+}
+
+VkResult swapchain_manager::present(VkQueue queue, VkSemaphore render_finished, unsigned int image_index){
+    VkPresentInfoKHR present_info {};
+    present_info.waitSemaphoreCount = 1;
+    present_info.swapchainCount = 1;
+    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    present_info.pWaitSemaphores = &render_finished;
+    present_info.pSwapchains = &current.swapchain;
+    present_info.pResults = nullptr;
+    present_info.pNext = nullptr;
+    present_info.pImageIndices = &image_index;
+
+    VkResult result = vkQueuePresentKHR(queue,&present_info);
+    if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) throw runtime_error("Error presenting");
+    return result;
+}
+
+void swapchain_manager::destroy_set(image_set &set){
+    for(VkImageView view : set.views) vkDestroyImageView(logical_device,view,nullptr);
+    for(const gpu_image &image : set.offscreen) allocator.destroy_image(image);
+    if(set.swapchain != VK_NULL_HANDLE) vkDestroySwapchainKHR(logical_device,set.swapchain,nullptr);
+    set = image_set();
+}
+
+void swapchain_manager::destroy(){
+    for(image_set &set : retired) destroy_set(set);
+    retired.clear();
+    destroy_set(current);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "gpu_allocator.hpp"
+
+//owns the images rendered into and their views: a swapchain on surface, or offscreen images from allocator
+//when surface is VK_NULL_HANDLE, recreate() builds the new swapchain from the old one and retires the old set instead of
+//waiting for the device to go idle, collect() destroys retired sets once the frames that used them have completed
+class swapchain_manager{
+public:
+    //image_count is exact for offscreen images, for swapchains it is added to the surface minimum
+    swapchain_manager(VkPhysicalDevice physical_device, VkDevice logical_device, gpu_allocator &allocator, VkSurfaceKHR surface,
+        VkSurfaceFormatKHR surface_format, VkPresentModeKHR present_mode, unsigned int queue_family, unsigned int image_count);
+
+    //window_extent is the drawable size, used when the surface leaves the extent to the application, retire_value is the
+    //graphics timeline value of the last frame rendered with the old set, returns false without recreating while the surface
+    //has a zero extent (minimized)
+    bool recreate(VkExtent2D window_extent, uint64_t retire_value);
+    void collect(uint64_t completed_value);
+    //takes effect on the next recreate()
+    void configure(VkPresentModeKHR present_mode, unsigned int image_count){ this->present_mode = present_mode; requested_image_count = image_count; }
+
+    //VK_SUBOPTIMAL_KHR and VK_ERROR_OUT_OF_DATE_KHR are returned rather than thrown, anything else fatal throws
+    VkResult acquire(VkSemaphore image_available, unsigned int &image_index);
+    VkResult present(VkQueue queue, VkSemaphore render_finished, unsigned int image_index);
+
+    VkExtent2D extent() const { return current_extent; }
+    VkPresentModeKHR mode() const { return present_mode; }
+    unsigned int image_count() const { return current.views.size(); }
+    //framebuffers are built around the view by the render graph, which retires them along with the set
+    VkImageView view(unsigned int image_index) const { return current.views[image_index]; }
+    unsigned int recreate_count() const { return recreates; }
+
+    //destroys the current and every retired set, the device must be idle
+    void destroy();
+
+private:
+    struct image_set{
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        std::vector<gpu_image> offscreen;
+        std::vector<VkImageView> views;
+        uint64_t retire_value = 0;
+    };
+    void destroy_set(image_set &set);
+
+    VkPhysicalDevice physical_device;
+    VkDevice logical_device;
+    gpu_allocator &allocator;
+    VkSurfaceKHR surface;
+    VkSurfaceFormatKHR surface_format;
+    VkPresentModeKHR present_mode;
+    unsigned int queue_family, requested_image_count, recreates = 0;
+
+    VkExtent2D current_extent = {0,0};
+    image_set current;
+    std::vector<image_set> retired;
+};
@@ -0,0 +1,80 @@
+#include "timeline.hpp"
+#include <stdexcept>
+using namespace std;
+
+queue_timeline::queue_timeline(VkDevice logical_device, VkQueue queue) : logical_device(logical_device), submit_queue(queue) {
+    VkSemaphoreTypeCreateInfo semaphore_type {};
+    semaphore_type.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    semaphore_type.pNext = nullptr;
+    semaphore_type.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphore_type.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_info {};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &semaphore_type;
+    semaphore_info.flags = 0;
+    if(vkCreateSemaphore(logical_device,&semaphore_info,nullptr,&semaphore)!=VK_SUCCESS) throw runtime_error("Error creating timeline semaphore");
+}
+
+uint64_t queue_timeline::completed(){
+    if(last_completed == last_submitted) return last_completed;
+    uint64_t value;
+    if(vkGetSemaphoreCounterValue(logical_device,semaphore,&value)!=VK_SUCCESS) throw runtime_error("Error reading timeline semaphore");
+    if(value > last_completed) last_completed = value;
+    return last_completed;
+}
+
+void queue_timeline::wait(uint64_t value){
+    if(value <= last_completed) return;
+    VkSemaphoreWaitInfo wait_info {};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.pNext = nullptr;
+    wait_info.flags = 0;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &semaphore;
+    wait_info.pValues = &value;
+    if(vkWaitSemaphores(logical_device,&wait_info,UINT64_MAX)!=VK_SUCCESS) throw runtime_error("Error waiting for timeline semaphore");
+    last_completed = value;
+}
+
+uint64_t queue_timeline::submit(VkCommandBuffer commandbuffer, const vector<semaphore_wait> &waits, VkSemaphore binary_signal){
+    vector<VkSemaphore> wait_semaphores(waits.size());
+    vector<uint64_t> wait_values(waits.size());
+    vector<VkPipelineStageFlags> wait_stages(waits.size());
+    for(size_t i = 0; i < waits.size(); ++i){
+        wait_semaphores[i] = waits[i].semaphore;
+        wait_values[i] = waits[i].value;
+        wait_stages[i] = waits[i].stages;
+    }
+
+    const uint64_t value = last_submitted+1;
+    VkSemaphore signal_semaphores[2] = {semaphore,binary_signal};
+    uint64_t signal_values[2] = {value,0};
+
+    VkTimelineSemaphoreSubmitInfo timeline_info {};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.pNext = nullptr;
+    timeline_info.waitSemaphoreValueCount = waits.size();
+    timeline_info.pWaitSemaphoreValues = wait_values.data();
+    timeline_info.signalSemaphoreValueCount = binary_signal != VK_NULL_HANDLE ? 2 : 1;
+    timeline_info.pSignalSemaphoreValues = signal_values;
+
+    VkSubmitInfo submit_info {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = &timeline_info;
+    submit_info.waitSemaphoreCount = waits.size();
+    submit_info.pWaitSemaphores = wait_semaphores.data();
+    submit_info.pWaitDstStageMask = wait_stages.data();
+    submit_info.commandBufferCount = commandbuffer != VK_NULL_HANDLE ? 1 : 0;
+    submit_info.pCommandBuffers = &commandbuffer;
+    submit_info.signalSemaphoreCount = timeline_info.signalSemaphoreValueCount;
+    submit_info.pSignalSemaphores = signal_semaphores;
+    if(vkQueueSubmit(submit_queue,1,&submit_info,VK_NULL_HANDLE)!=VK_SUCCESS) throw runtime_error("Error submitting queue");
+
+    last_submitted = value;
+    return value;
+}
+
+void queue_timeline::destroy(){
+    vkDestroySemaphore(logical_device,semaphore,nullptr);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+//something a submit waits on, value is ignored for binary semaphores
+struct semaphore_wait{
+    VkSemaphore semaphore;
+    uint64_t value;
+    VkPipelineStageFlags stages;
+};
+
+//one monotonically increasing timeline semaphore per queue, every submit through it signals the next value, so "has this
+//work finished" is a single integer comparison and CPU waits, resource retirement and cross-queue waits all use the same value
+class queue_timeline{
+public:
+    queue_timeline(VkDevice logical_device, VkQueue queue);
+
+    VkQueue queue() const { return submit_queue; }
+    VkSemaphore handle() const { return semaphore; }
+    //the value signalled by the most recent submit
+    uint64_t submitted() const { return last_submitted; }
+    //queries the semaphore, cached values only ever grow
+    uint64_t completed();
+    void wait(uint64_t value);
+
+    //submits commandbuffer (or nothing, when VK_NULL_HANDLE) after waits, signalling binary_signal too when given, returns the value signalled
+    uint64_t submit(VkCommandBuffer commandbuffer, const std::vector<semaphore_wait> &waits, VkSemaphore binary_signal = VK_NULL_HANDLE);
+
+    void destroy();
+
+private:
+    VkDevice logical_device;
+    VkQueue submit_queue;
+    VkSemaphore semaphore;
+    uint64_t last_submitted = 0, last_completed = 0;
+};
@@ -0,0 +1,228 @@
+#include "upload.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+upload_queue::upload_queue(VkDevice logical_device, gpu_allocator &allocator, const VkPhysicalDeviceProperties &device_properties, unsigned int transfer_family, queue_timeline &transfer,
+    unsigned int graphics_family, VkDeviceSize staging_size, unsigned int batch_count)
+    : logical_device(logical_device), allocator(allocator), transfer_family(transfer_family), graphics_family(graphics_family), transfer(transfer), staging_size(staging_size) {
+    //16 covers every texel block size and the 4 byte copy alignment
+    alignment = max<VkDeviceSize>(16,device_properties.limits.optimalBufferCopyOffsetAlignment);
+    staging = allocator.create_buffer(staging_size,VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkCommandPoolCreateInfo commandpool_info {};
+    commandpool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandpool_info.pNext = nullptr;
+    commandpool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandpool_info.queueFamilyIndex = transfer_family;
+
+    batches.resize(batch_count);
+    for(batch &current : batches){
+        if(vkCreateCommandPool(logical_device,&commandpool_info,nullptr,&current.commandpool)!=VK_SUCCESS) throw runtime_error("Error creating upload command pool");
+
+        VkCommandBufferAllocateInfo allocate_info {};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.pNext = nullptr;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.commandPool = current.commandpool;
+        allocate_info.commandBufferCount = 1;
+        if(vkAllocateCommandBuffers(logical_device,&allocate_info,&current.commandbuffer)!=VK_SUCCESS) throw runtime_error("Error allocating upload command buffer");
+        current.value = current.ring_begin = 0;
+    }
+}
+
+uint64_t upload_queue::ring_tail() const{
+    if(!in_flight.empty()) return batches[in_flight.front()].ring_begin;
+    if(open_batch != -1u) return batches[open_batch].ring_begin;
+    return ring_head;
+}
+
+VkDeviceSize upload_queue::reserve(VkDeviceSize size){
+    if(size > staging_size) throw runtime_error("Upload larger than the staging ring");
+    while(1){
+        uint64_t position = (ring_head+alignment-1)/alignment*alignment;
+        //never straddle the end of the ring, skip to the start instead
+        if(position%staging_size+size > staging_size) position = (position/staging_size+1)*staging_size;
+        if(position+size-ring_tail() <= staging_size){
+            if(open_batch == -1u) begin_batch(position);
+            ring_head = position+size;
+            return position%staging_size;
+        }
+        ++counters.ring_stalls;
+        if(!in_flight.empty()) retire();
+        else submit();
+    }
+}
+
+void upload_queue::begin_batch(uint64_t ring_begin){
+    //batches are reused round robin, so a batch still in flight is always the oldest one
+    if(!in_flight.empty() && in_flight.front() == next_batch) retire();
+    batch &current = batches[next_batch];
+    if(vkResetCommandPool(logical_device,current.commandpool,0)!=VK_SUCCESS) throw runtime_error("Error resetting upload command pool");
+
+    VkCommandBufferBeginInfo begin_info {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.pNext = nullptr;
+    begin_info.pInheritanceInfo = nullptr;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if(vkBeginCommandBuffer(current.commandbuffer,&begin_info)!=VK_SUCCESS) throw runtime_error("Error starting upload command buffer");
+
+    current.ring_begin = ring_begin;
+    open_batch = next_batch;
+    next_batch = (next_batch+1)%batches.size();
+}
+
+void upload_queue::submit(){
+    if(open_batch == -1u) return;
+    batch &current = batches[open_batch];
+
+    //one barrier call at the end of the batch releases everything it wrote
+    if(!release_buffers.empty() || !release_images.empty()){
+        vkCmdPipelineBarrier(current.commandbuffer,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,0,0,nullptr,
+            release_buffers.size(),release_buffers.data(),release_images.size(),release_images.data());
+        release_buffers.clear();
+        release_images.clear();
+    }
+    if(vkEndCommandBuffer(current.commandbuffer)!=VK_SUCCESS) throw runtime_error("Error ending upload command buffer");
+
+    current.value = submitted_value = transfer.submit(current.commandbuffer,{});
+    in_flight.push_back(open_batch);
+    open_batch = -1u;
+    ++counters.batches;
+
+    acquire_buffers.insert(acquire_buffers.end(),pending_acquire_buffers.begin(),pending_acquire_buffers.end());
+    acquire_images.insert(acquire_images.end(),pending_acquire_images.begin(),pending_acquire_images.end());
+    pending_acquire_buffers.clear();
+    pending_acquire_images.clear();
+    acquire_stages |= pending_stages;
+    wait_stages |= pending_stages;
+    pending_stages = 0;
+}
+
+void upload_queue::retire(){
+    transfer.wait(batches[in_flight.front()].value);
+    in_flight.pop_front();
+}
+
+void upload_queue::upload_buffer(VkBuffer buffer, VkDeviceSize offset, const void *data, VkDeviceSize size, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access){
+    const char *source = static_cast<const char*>(data);
+    for(VkDeviceSize done = 0; done < size;){
+        VkDeviceSize chunk = min(size-done,staging_size/2);
+        VkDeviceSize staging_offset = reserve(chunk);
+        memcpy(static_cast<char*>(staging.allocation.mapped)+staging_offset,source+done,chunk);
+
+        VkBufferCopy region {};
+        region.srcOffset = staging_offset;
+        region.dstOffset = offset+done;
+        region.size = chunk;
+        vkCmdCopyBuffer(batches[open_batch].commandbuffer,staging.buffer,buffer,1,&region);
+        done += chunk;
+    }
+    counters.bytes += size;
+
+    //copies in earlier batches are covered too, the release barrier's first scope includes prior submissions to the queue
+    VkBufferMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+    if(transfer_family != graphics_family){
+        barrier.srcQueueFamilyIndex = transfer_family;
+        barrier.dstQueueFamilyIndex = graphics_family;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        release_buffers.push_back(barrier);
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dst_access;
+        pending_acquire_buffers.push_back(barrier);
+    }
+    //on a single family the semaphore wait alone makes the copy visible
+    pending_stages |= dst_stage;
+}
+
+void upload_queue::upload_image(VkImage image, VkExtent3D extent, const void *data, VkDeviceSize size, VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access){
+    VkDeviceSize staging_offset = reserve(size);
+    memcpy(static_cast<char*>(staging.allocation.mapped)+staging_offset,data,size);
+    VkCommandBuffer commandbuffer = batches[open_batch].commandbuffer;
+
+    VkImageMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    vkCmdPipelineBarrier(commandbuffer,VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,0,0,nullptr,0,nullptr,1,&barrier);
+
+    VkBufferImageCopy region {};
+    region.bufferOffset = staging_offset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0,0,0};
+    region.imageExtent = extent;
+    vkCmdCopyBufferToImage(commandbuffer,staging.buffer,image,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1,&region);
+    counters.bytes += size;
+
+    //the transition to final_layout doubles as the release, the acquire repeats it on the graphics queue
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = final_layout;
+    if(transfer_family != graphics_family){
+        barrier.srcQueueFamilyIndex = transfer_family;
+        barrier.dstQueueFamilyIndex = graphics_family;
+    }
+    release_images.push_back(barrier);
+    if(transfer_family != graphics_family){
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dst_access;
+        pending_acquire_images.push_back(barrier);
+    }
+    pending_stages |= dst_stage;
+}
+
+semaphore_wait upload_queue::flush(){
+    submit();
+    semaphore_wait wait {transfer.handle(),0,0};
+    if(submitted_value != flushed_value){
+        wait.value = flushed_value = submitted_value;
+        wait.stages = wait_stages;
+        wait_stages = 0;
+    }
+    return wait;
+}
+
+void upload_queue::cmd_acquire(VkCommandBuffer commandbuffer){
+    if(acquire_buffers.empty() && acquire_images.empty()) return;
+    //the source stage chains with the semaphore wait, which is issued at the same stages
+    vkCmdPipelineBarrier(commandbuffer,acquire_stages,acquire_stages,0,0,nullptr,
+        acquire_buffers.size(),acquire_buffers.data(),acquire_images.size(),acquire_images.data());
+    acquire_buffers.clear();
+    acquire_images.clear();
+    acquire_stages = 0;
+}
+
+void upload_queue::report(FILE *out) const{
+    fprintf(out,"uploads: %.2f MiB in %llu batches, %llu staging ring stalls\n",counters.bytes/1048576.0,(unsigned long long)counters.batches,(unsigned long long)counters.ring_stalls);
+}
+
+void upload_queue::destroy(){
+    submit();
+    while(!in_flight.empty()) retire();
+    for(batch &current : batches) vkDestroyCommandPool(logical_device,current.commandpool,nullptr);
+    allocator.destroy_buffer(staging);
+}
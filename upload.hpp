@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "gpu_allocator.hpp"
+#include "timeline.hpp"
+
+struct upload_stats{
+    uint64_t bytes = 0, batches = 0, ring_stalls = 0;
+};
+
+//streams buffer and image data through a persistently mapped staging ring, copies are batched into one command buffer per
+//flush and submitted through the transfer queue's timeline, so the graphics queue only waits when it actually consumes
+//something new and the ring is recycled by timeline value, when the transfer queue is a different family ownership is released on it and
+//acquired again on the graphics queue by cmd_acquire
+class upload_queue{
+public:
+    upload_queue(VkDevice logical_device, gpu_allocator &allocator, const VkPhysicalDeviceProperties &device_properties, unsigned int transfer_family, queue_timeline &transfer,
+        unsigned int graphics_family, VkDeviceSize staging_size = 16ull<<20, unsigned int batch_count = 4);
+
+    //dst_stage and dst_access describe the first use on the graphics queue, buffers larger than the ring are split across batches
+    void upload_buffer(VkBuffer buffer, VkDeviceSize offset, const void *data, VkDeviceSize size, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+    //tightly packed texels for mip 0 layer 0 of a color image, which ends up in final_layout
+    void upload_image(VkImage image, VkExtent3D extent, const void *data, VkDeviceSize size, VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+
+    //submits the open batch, the next graphics submit must wait on the result (value 0 when nothing new was flushed) and record cmd_acquire
+    semaphore_wait flush();
+    void cmd_acquire(VkCommandBuffer commandbuffer);
+
+    const upload_stats &stats() const { return counters; }
+    void report(FILE *out) const;
+    //waits for every batch in flight
+    void destroy();
+
+private:
+    struct batch{
+        VkCommandPool commandpool;
+        VkCommandBuffer commandbuffer;
+        uint64_t value, ring_begin;
+    };
+
+    VkDeviceSize reserve(VkDeviceSize size);
+    uint64_t ring_tail() const;
+    void begin_batch(uint64_t ring_begin);
+    void submit();
+    void retire();
+
+    VkDevice logical_device;
+    gpu_allocator &allocator;
+    unsigned int transfer_family, graphics_family;
+    queue_timeline &transfer;
+    VkDeviceSize staging_size, alignment;
+    gpu_buffer staging;
+
+    //the transfer timeline value of the most recent batch and of the most recent flush
+    uint64_t submitted_value = 0, flushed_value = 0;
+    std::vector<batch> batches;
+    std::deque<unsigned int> in_flight;
+    unsigned int open_batch = -1u, next_batch = 0;
+    //virtual ring positions, the physical offset is position%staging_size
+    uint64_t ring_head = 0;
+
+    //barriers recorded at the end of the open batch, and the matching acquires once it has been submitted
+    std::vector<VkBufferMemoryBarrier> release_buffers, acquire_buffers, pending_acquire_buffers;
+    std::vector<VkImageMemoryBarrier> release_images, acquire_images, pending_acquire_images;
+    VkPipelineStageFlags release_stages = 0, pending_stages = 0, acquire_stages = 0, wait_stages = 0;
+    upload_stats counters;
+};